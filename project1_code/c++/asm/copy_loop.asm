@@ -0,0 +1,28 @@
+ADDI	R10 R0 524288
+LW	R11 0(R10)
+ADDI	R1 R0 64
+ADDI	R2 R0 0
+copy:	LW	R4 0(R2)
+ADDI	R2 R2 4
+SUBI	R1 R1 1
+SW	R4 4092(R2)
+BNEZ	R1 copy
+ADDI	R1 R0 64
+ADDI	R5 R0 0
+ADDI	R8 R0 0
+work:	LW	R6 8192(R8)
+ADDI	R8 R8 4
+ADD	R5 R5 R6
+XOR	R7 R5 R1
+ADD	R5 R5 R7
+SUBI	R1 R1 1
+BNEZ	R1 work
+LW	R12 0(R10)
+SUB	R12 R12 R11
+ADDI	R7 R0 32
+ADDI	R9 R0 10
+SW	R5 12(R10)
+SW	R7 8(R10)
+SW	R12 12(R10)
+SW	R9 8(R10)
+EOP
@@ -0,0 +1,14 @@
+ADDI	R10 R0 524288
+ADDI	R1 R0 100
+SW	R1 4(R10)
+wait:	LW	R2 4(R10)
+BNEZ	R2 wait
+LW	R3 0(R10)
+ADDI	R4 R0 84
+ADDI	R5 R0 32
+ADDI	R6 R0 10
+SW	R4 8(R10)
+SW	R5 8(R10)
+SW	R3 12(R10)
+SW	R6 8(R10)
+EOP
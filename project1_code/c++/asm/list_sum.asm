@@ -0,0 +1,6 @@
+loop:	LW	R2 4(R1)
+ADD	R3 R3 R2
+LW	R1 0(R1)
+BNEZ	R1 loop
+SW	R3 0(R5)
+EOP	
@@ -0,0 +1,8 @@
+loop:	LW	R4 0(R0)
+ADD	R3 R3 R4
+SW	R3 4(R0)
+XOR	R5 R3 R4
+ADDI	R2 R2 4
+SUBI	R1 R1 1
+BNEZ	R1 loop
+EOP	
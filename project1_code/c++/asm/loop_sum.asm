@@ -0,0 +1,10 @@
+ADDI	R1 R0 8
+ADDI	R2 R0 0
+ADDI	R3 R0 0
+loop:	LW	R4 0(R2)
+ADD	R3 R3 R4
+ADDI	R2 R2 4
+SUBI	R1 R1 1
+BNEZ	R1 loop
+SW	R3 32(R0)
+EOP	
@@ -0,0 +1,7 @@
+loop:	LW	R4 0(R2)
+ADD	R3 R3 R4
+ADD	R2 R2 R6
+SUBI	R1 R1 1
+BNEZ	R1 loop
+SW	R3 0(R5)
+EOP	
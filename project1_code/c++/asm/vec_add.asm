@@ -0,0 +1,12 @@
+ADDI	R2 R0 0
+ADDI	R5 R0 0
+loop:	VLW	V1 0(R2)
+VLW	V2 4096(R2)
+VADD	V3 V1 V2
+VSW	V3 8192(R2)
+VREDSUM	R3 V3
+ADD	R5 R5 R3
+ADD	R2 R2 R6
+SUBI	R1 R1 1
+BNEZ	R1 loop
+EOP
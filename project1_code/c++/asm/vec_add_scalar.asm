@@ -0,0 +1,11 @@
+ADDI	R2 R0 0
+ADDI	R5 R0 0
+loop:	LW	R3 0(R2)
+LW	R4 4096(R2)
+ADD	R3 R3 R4
+SW	R3 8192(R2)
+ADD	R5 R5 R3
+ADDI	R2 R2 4
+SUBI	R1 R1 1
+BNEZ	R1 loop
+EOP
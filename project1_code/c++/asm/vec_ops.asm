@@ -0,0 +1,14 @@
+ADDI	R2 R0 0
+ADDI	R3 R0 12288
+VLWS	V1 R2 16
+VLW	V2 4096(R2)
+VSUB	V3 V2 V1
+VXOR	V4 V1 V2
+VMUL	V5 V1 V2
+VMUL	V6 V5 V5
+VSWS	V5 R3 8
+VSW	V3 0(R3)
+VREDSUM	R4 V5
+VREDXOR	R5 V4
+LW	R6 8(R3)
+EOP
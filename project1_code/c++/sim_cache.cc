@@ -0,0 +1,149 @@
+#include "sim_cache.h"
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <stdio.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+using namespace std;
+
+#define CACHE_FORMAT "sim_cache 3"
+
+/* writes "size" bytes as hex digits */
+static void write_hex(ostream &out, const unsigned char *data, size_t size){
+	static const char digits[] = "0123456789abcdef";
+	for (size_t i=0; i<size; i++) out << digits[data[i] >> 4] << digits[data[i] & 0xF];
+}
+
+/* value of hex digit "c" (-1 if it is not one) */
+static int hex_digit(char c){
+	if (c >= '0' && c <= '9') return c - '0';
+	if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+	if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+	return -1;
+}
+
+/* appends the bytes of the hex digits read from "in"; returns false if they are malformed */
+static bool read_hex(istream &in, vector<unsigned char> &data){
+	string text;
+	if (!(in >> text) || text.length() % 2) return false;
+	for (size_t i=0; i<text.length(); i+=2){
+		int high = hex_digit(text[i]), low = hex_digit(text[i+1]);
+		if (high < 0 || low < 0) return false;
+		data.push_back(high << 4 | low);
+	}
+	return true;
+}
+
+sim_cache::sim_cache(const char *dir){
+	directory = dir;
+	mkdir(dir, 0755);
+	hits = misses = 0;
+}
+
+unsigned long long sim_cache::executable_hash(){
+	static unsigned long long hash = 0;
+	static bool computed = false;
+	if (!computed){
+		sim_hash h;
+		ifstream fin("/proc/self/exe", ios::in | ios::binary);
+		char buffer[65536];
+		while (fin.read(buffer, sizeof buffer) || fin.gcount()) h.add(buffer, fin.gcount());
+		hash = h.get();
+		computed = true;
+	}
+	return hash;
+}
+
+string sim_cache::entry(unsigned long long key){
+	char name[32];
+	snprintf(name, sizeof name, "/%016llx", key);
+	return directory + name;
+}
+
+bool sim_cache::lookup(unsigned long long key, sim_result_t &result){
+	ifstream fin(entry(key).c_str(), ios::in);
+	string format, field;
+	bool valid = fin.is_open() && getline(fin, format) && format == CACHE_FORMAT;
+	if (valid){
+		result.registers.clear();
+		result.state.clear();
+		result.profile.clear();
+		result.console.clear();
+		result.pages.clear();
+		result.page_data.clear();
+		while (valid && fin >> field){
+			if (field == "cycles") fin >> result.clock_cycles;
+			else if (field == "instructions") fin >> result.instructions_executed;
+			else if (field == "stalls") fin >> result.stalls;
+			else if (field == "memory") fin >> hex >> result.memory_digest >> dec;
+			else if (field == "registers" || field == "state" || field == "profile") {
+				vector<unsigned> &values = (field == "registers") ? result.registers : (field == "state") ? result.state : result.profile;
+				string line;
+				getline(fin, line);
+				stringstream ss(line);
+				unsigned value;
+				while (ss >> hex >> value) values.push_back(value);
+			}
+			else if (field == "console") {
+				unsigned length;
+				vector<unsigned char> text;
+				valid = fin >> dec >> length && (length == 0 || read_hex(fin, text)) && text.size() == length;
+				result.console.assign(text.begin(), text.end());
+			}
+			else if (field == "page") {
+				unsigned page;
+				valid = fin >> dec >> page && read_hex(fin, result.page_data);
+				result.pages.push_back(page);
+			}
+		}
+		valid = valid && !fin.bad() && !result.registers.empty();
+	}
+	if (valid) hits++;
+	else misses++;
+	return valid;
+}
+
+void sim_cache::store(unsigned long long key, const sim_result_t &result){
+	// written to a temporary file, then renamed: readers never see a partial entry
+	string path = entry(key);
+	string temporary = path + "." + to_string(getpid());
+	ofstream fout(temporary.c_str(), ios::out);
+	if (!fout.is_open()) {
+		cerr << "warning: cannot write the cache entry " << path << endl;
+		return;
+	}
+	fout << CACHE_FORMAT << endl;
+	fout << "cycles " << result.clock_cycles << endl;
+	fout << "instructions " << result.instructions_executed << endl;
+	fout << "stalls " << result.stalls << endl;
+	fout << "registers" << hex;
+	for (unsigned i=0; i<result.registers.size(); i++) fout << " " << result.registers[i];
+	fout << endl << "state";
+	for (unsigned i=0; i<result.state.size(); i++) fout << " " << result.state[i];
+	fout << endl << "profile";
+	for (unsigned i=0; i<result.profile.size(); i++) fout << " " << result.profile[i];
+	fout << endl << "memory " << result.memory_digest << dec << endl;
+	fout << "console " << result.console.length();
+	if (!result.console.empty()) {
+		fout << " ";
+		write_hex(fout, (const unsigned char *)result.console.data(), result.console.length());
+	}
+	fout << endl;
+	size_t page_size = result.pages.empty() ? 0 : result.page_data.size() / result.pages.size();
+	for (unsigned k=0; k<result.pages.size(); k++){
+		fout << "page " << result.pages[k] << " ";
+		write_hex(fout, &result.page_data[k * page_size], page_size);
+		fout << endl;
+	}
+	fout.close();
+	if (fout.fail() || rename(temporary.c_str(), path.c_str()) != 0) {
+		cerr << "warning: cannot write the cache entry " << path << endl;
+		unlink(temporary.c_str());
+	}
+}
+
+unsigned sim_cache::get_hits(){return hits;}
+
+unsigned sim_cache::get_misses(){return misses;}
@@ -0,0 +1,81 @@
+#ifndef SIM_CACHE_H_
+#define SIM_CACHE_H_
+
+#include <string>
+#include <vector>
+
+using namespace std;
+
+// 64-bit FNV-1a hash, used for the keys and the digests of the result cache
+class sim_hash{
+
+	unsigned long long h;
+
+public:
+
+	sim_hash() : h(0xcbf29ce484222325ULL) {}
+
+	inline void add(const void *data, unsigned long long size){
+		const unsigned char *bytes = (const unsigned char *)data;
+		for (unsigned long long i=0; i<size; i++) h = (h ^ bytes[i]) * 0x100000001b3ULL;
+	}
+
+	inline void add(unsigned long long value){ add(&value, sizeof value); }
+
+	inline void add(const string &s){ add(s.size()); add(s.data(), s.size()); }
+
+	inline unsigned long long get(){ return h; }
+};
+
+// final state of a simulation, as stored in the cache
+typedef struct{
+	unsigned clock_cycles;
+	unsigned instructions_executed;
+	unsigned stalls;
+	vector<unsigned> registers;
+	vector<unsigned> state; //pipeline registers, IR and thread context (see sim_pipe_base::save_result)
+	vector<unsigned> profile; //per-PC profile counters (see sim_profile::save)
+	unsigned long long memory_digest;
+	string console; //output of the device console
+	vector<unsigned> pages; //data memory pages written since the reset before the run
+	vector<unsigned char> page_data; //their final content, one page after the other
+} sim_result_t;
+
+/*
+On-disk cache of simulation results, keyed by a hash of everything the result depends
+on (see sim_pipe_core::run(sim_cache&)). The simulator is deterministic, so a job whose
+key is in the cache does not need to be simulated again.
+
+Each result is a small text file named after its key in the cache directory. The hash of
+the running executable is part of every key: rebuilding the simulator invalidates the
+entries written by the previous build.
+*/
+class sim_cache{
+
+	string directory;
+
+	unsigned hits, misses;
+
+	// path of the entry of "key"
+	string entry(unsigned long long key);
+
+public:
+
+	//opens the cache in "dir", which is created if it does not exist
+	sim_cache(const char *dir);
+
+	//returns the hash of the running executable (computed once)
+	static unsigned long long executable_hash();
+
+	//returns true and fills "result" if "key" is in the cache
+	bool lookup(unsigned long long key, sim_result_t &result);
+
+	//stores the result of "key" - concurrent writers of the same key are harmless
+	void store(unsigned long long key, const sim_result_t &result);
+
+	unsigned get_hits();
+
+	unsigned get_misses();
+};
+
+#endif /*SIM_CACHE_H_*/
@@ -0,0 +1,129 @@
+#include "sim_devices.h"
+#include "sim_pipe.h"
+#include <iostream>
+#include <cstring>
+#include <stdlib.h>
+
+using namespace std;
+
+sim_devices::sim_devices(){
+	memory = NULL;
+	memory_size = 0;
+	reset();
+}
+
+void sim_devices::connect(unsigned char *mem, unsigned mem_size){
+	memory = mem;
+	memory_size = mem_size;
+}
+
+void sim_devices::reset(){
+	timer_end = 0;
+	console.clear();
+	dma_src = dma_dst = dma_len = 0;
+	dma_busy = false;
+	dma_copied = 0;
+	dma_loaded = false;
+	dma_buffer = UNDEFINED;
+	dma_words = dma_port_cycles = dma_wait_cycles = 0;
+	dirty_begin = dirty_end = 0;
+}
+
+unsigned sim_devices::read(unsigned offset, unsigned cycle){
+	switch(offset){
+		case IO_CYCLES:
+			return cycle;
+		case IO_TIMER:
+			return (timer_end > cycle) ? timer_end - cycle : 0;
+		case IO_DMA_SRC:
+			return dma_src;
+		case IO_DMA_DST:
+			return dma_dst;
+		case IO_DMA_LEN:
+			return dma_len;
+		case IO_DMA_CTRL:
+			return dma_busy;
+		default:
+			return UNDEFINED;
+	}
+}
+
+void sim_devices::write(unsigned offset, unsigned value, unsigned cycle){
+	switch(offset){
+		case IO_TIMER:
+			timer_end = cycle + value;
+			break;
+		case IO_CONSOLE:
+			console += (char)(value & 0xFF);
+			break;
+		case IO_CONSOLE_INT:
+			console += to_string((int)value);
+			break;
+		case IO_DMA_SRC:
+			if (!dma_busy) dma_src = value;
+			break;
+		case IO_DMA_DST:
+			if (!dma_busy) dma_dst = value;
+			break;
+		case IO_DMA_LEN:
+			if (!dma_busy) dma_len = value;
+			break;
+		case IO_DMA_CTRL:
+			if (value != 1 || dma_busy) break;
+			if (dma_len % 4 || dma_len > memory_size || dma_src > memory_size - dma_len || dma_dst > memory_size - dma_len) {
+				cerr << "error: DMA transfer of " << dma_len << " bytes from 0x" << hex << dma_src << " to 0x" << dma_dst << dec << " outside data memory!" << endl;
+				exit(-1);
+			}
+			dma_copied = 0;
+			dma_loaded = false;
+			dma_busy = (dma_len != 0);
+			if (dma_busy && dirty_begin == dirty_end) {
+				dirty_begin = dma_dst;
+				dirty_end = dma_dst + dma_len;
+			} else if (dma_busy) {
+				if (dma_dst < dirty_begin) dirty_begin = dma_dst;
+				if (dma_dst + dma_len > dirty_end) dirty_end = dma_dst + dma_len;
+			}
+			break;
+		default:
+			break;
+	}
+}
+
+void sim_devices::dma_step(unsigned cycle, unsigned &port_free, unsigned latency){
+	if (port_free > cycle) {
+		dma_wait_cycles++;
+		return;
+	}
+	port_free = cycle + latency + 1;
+	dma_port_cycles += latency + 1;
+	if (!dma_loaded) {
+		memcpy(&dma_buffer, &memory[dma_src + dma_copied], 4);
+		dma_loaded = true;
+	} else {
+		memcpy(&memory[dma_dst + dma_copied], &dma_buffer, 4);
+		dma_loaded = false;
+		dma_copied += 4;
+		dma_words++;
+		if (dma_copied == dma_len) dma_busy = false;
+	}
+}
+
+void sim_devices::get_dma_dirty(unsigned &begin, unsigned &end){
+	begin = dirty_begin;
+	end = dirty_end;
+	if (dma_busy) {
+		dirty_begin = dma_dst;
+		dirty_end = dma_dst + dma_len;
+	} else dirty_begin = dirty_end = 0;
+}
+
+const string &sim_devices::get_console(){return console;}
+
+void sim_devices::set_console(const string &text){console = text;}
+
+unsigned sim_devices::get_dma_words(){return dma_words;}
+
+unsigned sim_devices::get_dma_port_cycles(){return dma_port_cycles;}
+
+unsigned sim_devices::get_dma_wait_cycles(){return dma_wait_cycles;}
@@ -0,0 +1,98 @@
+#ifndef SIM_DEVICES_H_
+#define SIM_DEVICES_H_
+
+#include <string>
+
+using namespace std;
+
+#define IO_SIZE 0x20 // size in bytes of the device region
+
+// device registers - offsets from the base address of the device region
+#define IO_CYCLES 0x00      // read: current clock cycle
+#define IO_TIMER 0x04       // write: starts a count-down of "value" cycles; read: cycles left (0 when expired)
+#define IO_CONSOLE 0x08     // write: prints the low byte as a character
+#define IO_CONSOLE_INT 0x0C // write: prints the value as a signed decimal number
+#define IO_DMA_SRC 0x10     // DMA source address
+#define IO_DMA_DST 0x14     // DMA destination address
+#define IO_DMA_LEN 0x18     // DMA length in bytes (multiple of 4)
+#define IO_DMA_CTRL 0x1C    // write 1: starts the transfer; read: 1 while the transfer is in progress
+
+/*
+Memory-mapped devices: cycle counter/timer, console output port and DMA engine.
+
+The DMA engine copies one word at a time - a read followed by a write - through
+the memory port it shares with the MEM stage of the core. The core has priority:
+the DMA only starts an access in a cycle in which the port is free, and an access
+it has started delays the core until it completes. Each access holds the port
+for 1 + data memory latency cycles.
+*/
+class sim_devices{
+
+	// data memory the DMA engine copies within
+	unsigned char *memory;
+	unsigned memory_size;
+
+	// cycle the timer expires
+	unsigned timer_end;
+
+	// characters written to the console
+	string console;
+
+	// DMA registers
+	unsigned dma_src, dma_dst, dma_len;
+	bool dma_busy;
+
+	// bytes copied so far, word read and not written yet
+	unsigned dma_copied;
+	bool dma_loaded;
+	unsigned dma_buffer;
+
+	// DMA statistics
+	unsigned dma_words, dma_port_cycles, dma_wait_cycles;
+
+	// destination range [dirty_begin, dirty_end) of the transfers since the last get_dma_dirty
+	unsigned dirty_begin, dirty_end;
+
+public:
+
+	sim_devices();
+
+	//connects the DMA engine to the data memory
+	void connect(unsigned char *mem, unsigned mem_size);
+
+	//resets the devices (the console output and the DMA statistics included)
+	void reset();
+
+	//accesses the device register at "offset" in clock cycle "cycle"
+	unsigned read(unsigned offset, unsigned cycle);
+
+	void write(unsigned offset, unsigned value, unsigned cycle);
+
+	//true while a DMA transfer is in progress
+	inline bool dma_active(){ return dma_busy; }
+
+	//advances the DMA engine in clock cycle "cycle"; "port_free" is the first cycle the memory port
+	//is not used by the core (updated when the DMA engine takes it)
+	void dma_step(unsigned cycle, unsigned &port_free, unsigned latency);
+
+	//returns the destination range [begin, end) the DMA engine may have written since the last call
+	//(begin == end if none) - the range of a transfer in progress is returned again by the next call
+	void get_dma_dirty(unsigned &begin, unsigned &end);
+
+	//returns the characters written to the console
+	const string &get_console();
+
+	//replaces the characters written to the console (final state restored from a result cache)
+	void set_console(const string &text);
+
+	//returns the number of words copied by the DMA engine
+	unsigned get_dma_words();
+
+	//returns the number of cycles the DMA engine held the memory port
+	unsigned get_dma_port_cycles();
+
+	//returns the number of cycles the DMA engine waited for the memory port
+	unsigned get_dma_wait_cycles();
+};
+
+#endif /*SIM_DEVICES_H_*/
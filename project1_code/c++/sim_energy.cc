@@ -0,0 +1,185 @@
+#include "sim_energy.h"
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <string>
+#include <string.h>
+#include <stdlib.h>
+
+using namespace std;
+
+/* =============================================================
+
+   ENERGY TABLE
+
+   ============================================================= */
+
+/* default energies, in pJ, of a small in-order core: the memories dominate, a multiply costs
+   several additions, a pipeline register bit about as much as a gate */
+energy_table_t default_energy_table(){
+	energy_table_t table;
+	table.latch_toggle = 0.02;
+	table.latch_clock = 0.5;
+	table.fetch = 8.0;
+	table.reg_read = 1.0;
+	table.reg_write = 1.2;
+	for (unsigned i=0; i<NUM_OPCODES; i++) table.alu[i] = 0.5;
+	table.alu[NOP] = 0.0;
+	table.alu[VMUL] = 3.0;
+	table.alu[EOP] = 0.0;
+	table.mem_read = 10.0;
+	table.mem_write = 10.0;
+	table.bubble = 0.2;
+	table.flush = 0.0;
+	table.leakage = 2.0;
+	table.cycle_time = 1.0;
+	table.latch_delay = 0.1;
+	return table;
+}
+
+void read_energy_table(const char *filename, energy_table_t &table){
+	ifstream fin(filename, ios::in);
+	if (!fin.is_open()) {
+		cerr << "error: open file " << filename << " failed!" << endl;
+		exit(-1);
+	}
+	struct { const char *name; double *field; } fields[] = {
+		{"latch_toggle", &table.latch_toggle}, {"latch_clock", &table.latch_clock}, {"fetch", &table.fetch},
+		{"reg_read", &table.reg_read}, {"reg_write", &table.reg_write}, {"mem_read", &table.mem_read},
+		{"mem_write", &table.mem_write}, {"bubble", &table.bubble}, {"flush", &table.flush},
+		{"leakage", &table.leakage}, {"cycle_time", &table.cycle_time}, {"latch_delay", &table.latch_delay}
+	};
+	string line, name;
+	double value;
+	unsigned line_number = 0;
+	while (getline(fin, line)){
+		line_number++;
+		stringstream ss(line);
+		if (!(ss >> name) || name[0] == '#') continue;
+		if (!(ss >> value) || value < 0) {
+			cerr << "error: " << filename << ":" << line_number << ": invalid value for " << name << endl;
+			exit(-1);
+		}
+		double *field = NULL;
+		for (unsigned i=0; i<sizeof(fields)/sizeof(fields[0]); i++)
+			if (name == fields[i].name) field = fields[i].field;
+		if (name.compare(0, 4, "alu.") == 0)
+			for (unsigned i=0; i<NUM_OPCODES; i++)
+				if (name.substr(4) == opcode_name((opcode_t)i)) field = &table.alu[i];
+		if (field == NULL) {
+			cerr << "error: " << filename << ":" << line_number << ": unknown energy " << name << endl;
+			exit(-1);
+		}
+		*field = value;
+	}
+	if (table.cycle_time <= table.latch_delay) {
+		cerr << "error: " << filename << ": cycle_time must be larger than latch_delay" << endl;
+		exit(-1);
+	}
+	fin.close();
+}
+
+/* =============================================================
+
+   ENERGY OBSERVER
+
+   ============================================================= */
+
+energy_observer::energy_observer(){
+	configure(default_energy_table());
+}
+
+void energy_observer::configure(const energy_table_t &energy_table, unsigned interval_cycles){
+	table = energy_table;
+	interval = interval_cycles;
+	depth = 5;
+	memset(&total, 0, sizeof(activity_t));
+	memset(&current, 0, sizeof(activity_t));
+	memset(previous, 0, sizeof(previous));
+	intervals.clear();
+}
+
+void energy_observer::close_interval(){
+	if (current.cycles == 0) return;
+	energy_interval_t record = {total.cycles - current.cycles, current.cycles, energy(current)};
+	intervals.push_back(record);
+	memset(&current, 0, sizeof(activity_t));
+}
+
+double energy_observer::energy(const activity_t &activity){
+	double e = 0;
+	for (unsigned l=0; l<MAX_STAGES-1; l++) e += activity.latch_toggles[l] * table.latch_toggle;
+	e += activity.latch_clocks * table.latch_clock;
+	e += activity.fetches * table.fetch;
+	e += activity.reg_reads * table.reg_read + activity.reg_writes * table.reg_write;
+	for (unsigned i=0; i<NUM_OPCODES; i++) e += activity.alu[i] * table.alu[i];
+	e += activity.mem_reads * table.mem_read + activity.mem_writes * table.mem_write;
+	e += activity.bubbles * table.bubble + activity.flushes * table.flush;
+	e += activity.cycles * table.leakage;
+	return e;
+}
+
+double energy_observer::cycle_time(){
+	return (table.cycle_time - table.latch_delay) * 5 / depth + table.latch_delay;
+}
+
+double energy_observer::get_energy(){return energy(total);}
+
+double energy_observer::get_time(){return total.cycles * cycle_time();}
+
+/* pJ / ns = mW */
+double energy_observer::get_power(){
+	double time = get_time();
+	return time > 0 ? get_energy() / time : 0;
+}
+
+double energy_observer::get_edp(){return get_energy() * get_time();}
+
+void energy_observer::print_report(){
+	unsigned long long toggles = 0;
+	unsigned alu_ops = 0;
+	double alu_energy = 0;
+	for (unsigned l=0; l<MAX_STAGES-1; l++) toggles += total.latch_toggles[l];
+	for (unsigned i=0; i<NUM_OPCODES; i++) {
+		alu_ops += total.alu[i];
+		alu_energy += total.alu[i] * table.alu[i];
+	}
+
+	struct { const char *name; unsigned long long count; double energy; } rows[] = {
+		{"pipeline register bits", toggles, toggles * table.latch_toggle},
+		{"pipeline register clocks", total.latch_clocks, total.latch_clocks * table.latch_clock},
+		{"instruction fetches", total.fetches, total.fetches * table.fetch},
+		{"register reads", total.reg_reads, total.reg_reads * table.reg_read},
+		{"register writes", total.reg_writes, total.reg_writes * table.reg_write},
+		{"EX operations", alu_ops, alu_energy},
+		{"memory reads", total.mem_reads, total.mem_reads * table.mem_read},
+		{"memory writes", total.mem_writes, total.mem_writes * table.mem_write},
+		{"bubbles", total.bubbles, total.bubbles * table.bubble},
+		{"squashed slots", total.flushes, total.flushes * table.flush},
+		{"leakage (cycles)", total.cycles, total.cycles * table.leakage}
+	};
+	double e = get_energy();
+
+	cout << "ENERGY (" << depth << "-stage pipeline, cycle time " << fixed << setprecision(3) << cycle_time() << " ns)" << endl;
+	cout << setfill(' ') << left << setw(28) << "component" << right << setw(12) << "events" << setw(14) << "energy (pJ)" << setw(8) << "%" << endl;
+	for (unsigned r=0; r<sizeof(rows)/sizeof(rows[0]); r++){
+		cout << left << setw(28) << rows[r].name << right << setw(12) << rows[r].count;
+		cout << setw(14) << setprecision(1) << rows[r].energy << setw(8) << (e > 0 ? 100 * rows[r].energy / e : 0) << endl;
+	}
+	cout << "Energy = " << setprecision(1) << e << " pJ" << endl;
+	cout << "Time = " << setprecision(1) << get_time() << " ns" << endl;
+	cout << "Average power = " << setprecision(2) << get_power() << " mW" << endl;
+	cout << "Energy-delay product = " << setprecision(1) << get_edp() << " pJ*ns" << endl;
+
+	if (interval) {
+		close_interval();
+		cout << endl << setw(10) << "cycle" << setw(10) << "cycles" << setw(14) << "energy (pJ)" << setw(12) << "power (mW)" << endl;
+		for (unsigned i=0; i<intervals.size(); i++){
+			cout << setw(10) << intervals[i].first_cycle << setw(10) << intervals[i].cycles;
+			cout << setw(14) << setprecision(1) << intervals[i].energy;
+			cout << setw(12) << setprecision(2) << intervals[i].energy / (intervals[i].cycles * cycle_time()) << endl;
+		}
+	}
+	cout << defaultfloat << setprecision(6);
+}
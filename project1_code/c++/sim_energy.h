@@ -0,0 +1,157 @@
+#ifndef SIM_ENERGY_H_
+#define SIM_ENERGY_H_
+
+#include "sim_pipe_core.h"
+#include <vector>
+
+using namespace std;
+
+// energy of each event in pJ (see default_energy_table in sim_energy.cc)
+typedef struct{
+	double latch_toggle; //per bit of a pipeline register that changes value
+	double latch_clock; //per pipeline register per cycle (clock tree)
+	double fetch; //instruction memory read
+	double reg_read; //register operand read
+	double reg_write; //register write-back
+	double alu[NUM_OPCODES]; //EX operation, per element
+	double mem_read; //data memory word read
+	double mem_write; //data memory word write
+	double bubble; //bubble inserted by a stall
+	double flush; //wrong-path slot squashed
+	double leakage; //static energy per cycle
+	double cycle_time; //cycle time of the 5-stage pipeline in ns
+	double latch_delay; //part of the cycle time spent in the pipeline register (not divided by deeper pipelines)
+} energy_table_t;
+
+//returns the default energy table
+energy_table_t default_energy_table();
+
+//reads an energy table: one "<name> <value>" pair per line, starting from the default table
+//names are the fields of energy_table_t, "alu.<OPCODE>" for the ALU entries; lines starting with '#' are ignored
+void read_energy_table(const char *filename, energy_table_t &table);
+
+// activity counters
+typedef struct{
+	unsigned cycles;
+	unsigned long long latch_toggles[MAX_STAGES-1]; //bits changed, by pipeline register
+	unsigned latch_clocks; //pipeline registers clocked
+	unsigned fetches;
+	unsigned reg_reads, reg_writes;
+	unsigned alu[NUM_OPCODES]; //elements operated on, by opcode
+	unsigned mem_reads, mem_writes;
+	unsigned bubbles;
+	unsigned flushes; //squashed slots
+} activity_t;
+
+// energy of an interval of the run
+typedef struct{
+	unsigned first_cycle;
+	unsigned cycles;
+	double energy; //pJ
+} energy_interval_t;
+
+/*
+Activity-based energy model, as an observer policy of sim_pipe_core:
+
+	sim_pipe_core<energy_observer, pipeline_8> *mips = ...;
+	mips->get_observer().configure(table, 1000);
+	mips->run();
+	mips->get_observer().print_report();
+
+Every event of the pipeline is counted (pipeline register bits that toggle, register file
+reads and writes, EX operations by opcode, instruction and data memory accesses, bubbles
+and squashed slots) and weighted by the energy table. The cycle time of a pipeline of
+depth D is (cycle_time - latch_delay) * 5 / D + latch_delay, so deeper pipelines trade
+more pipeline register energy for shorter cycles.
+*/
+struct energy_observer : public null_observer {
+
+	energy_table_t table;
+
+	//cycles per interval (0: no intervals)
+	unsigned interval;
+
+	//pipeline depth, known from the first cycle
+	unsigned depth;
+
+	//activity of the whole run and of the current interval
+	activity_t total, current;
+
+	//closed intervals
+	vector<energy_interval_t> intervals;
+
+	//content of the pipeline registers at the end of the previous cycle (data words, then opcode/src1/src2/dest/immediate)
+	unsigned previous[MAX_STAGES-1][LATCH_WORDS+5];
+
+	energy_observer();
+
+	//sets the energy table and the interval length (in cycles, 0 for none), and clears the counters
+	void configure(const energy_table_t &energy_table, unsigned interval_cycles=0);
+
+	inline void on_retire(const retire_event_t &e){
+		if (writes_register(e.instr->opcode)) { total.reg_writes++; current.reg_writes++; }
+	}
+
+	inline void on_memory(const memory_event_t &e){
+		if (e.is_store) { total.mem_writes++; current.mem_writes++; }
+		else { total.mem_reads++; current.mem_reads++; }
+	}
+
+	inline void on_stall(const stall_event_t &e){ total.bubbles++; current.bubbles++; }
+
+	inline void on_flush(const flush_event_t &e){ total.flushes += e.slots; current.flushes += e.slots; }
+
+	inline void on_cycle(const cycle_event_t &e){
+		depth = e.latches + 1;
+		for (unsigned l=0; l<e.latches; l++){
+			const unsigned *data = e.latch_data + l*LATCH_WORDS;
+			const instruction_t &instr = e.latch_ir[l];
+			unsigned now[LATCH_WORDS+5];
+			for (unsigned w=0; w<LATCH_WORDS; w++) now[w] = data[w];
+			now[LATCH_WORDS] = instr.opcode;
+			now[LATCH_WORDS+1] = instr.src1;
+			now[LATCH_WORDS+2] = instr.src2;
+			now[LATCH_WORDS+3] = instr.dest;
+			now[LATCH_WORDS+4] = instr.immediate;
+			unsigned toggles = 0;
+			for (unsigned w=0; w<LATCH_WORDS+5; w++){
+				toggles += __builtin_popcount(now[w] ^ previous[l][w]);
+				previous[l][w] = now[w];
+			}
+			total.latch_toggles[l] += toggles;
+			current.latch_toggles[l] += toggles;
+		}
+		total.latch_clocks += e.latches;
+		current.latch_clocks += e.latches;
+		if (e.fetch) { total.fetches++; current.fetches++; }
+		total.reg_reads += e.reg_reads;
+		current.reg_reads += e.reg_reads;
+		total.alu[e.alu_op] += e.alu_elements;
+		current.alu[e.alu_op] += e.alu_elements;
+		total.cycles++;
+		if (++current.cycles == interval) close_interval();
+	}
+
+	//ends the current interval
+	void close_interval();
+
+	//returns the energy (pJ) of the activity
+	double energy(const activity_t &activity);
+
+	//returns the cycle time (ns) of the pipeline
+	double cycle_time();
+
+	//returns the energy of the run (pJ), its duration (ns), the average power (mW) and the energy-delay product (pJ*ns)
+	double get_energy();
+
+	double get_time();
+
+	double get_power();
+
+	double get_edp();
+
+	//prints the activity counters, the energy by component, the totals and the intervals
+	void print_report();
+};
+
+#endif /*SIM_ENERGY_H_*/
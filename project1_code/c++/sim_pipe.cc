@@ -1,6 +1,6 @@
 
 //#define DEBUG
-#include "sim_pipe.h"
+#include "sim_pipe_core.h"
 #include <stdlib.h>
 #include <iostream>
 #include <fstream>
@@ -14,101 +14,85 @@ using namespace std;
 //used for debugging purposes
 static const char *reg_names[NUM_SP_REGISTERS] = {"PC", "NPC", "IR", "A", "B", "IMM", "COND", "ALU_OUTPUT", "LMD"};
 static const char *stage_names[NUM_STAGES] = {"IF", "ID", "EX", "MEM", "WB"};
-static const char *instr_names[NUM_OPCODES] = {"LW", "SW", "ADD", "ADDI", "SUB", "SUBI", "XOR", "BEQZ", "BNEZ", "BLTZ", "BGTZ", "BLEZ", "BGEZ", "JUMP", "EOP", "NOP"};
+static const char *instr_names[NUM_OPCODES] = {"LW", "SW", "ADD", "ADDI", "SUB", "SUBI", "XOR", "BEQZ", "BNEZ", "BLTZ", "BGTZ", "BLEZ", "BGEZ", "JUMP",
+	"VLW", "VSW", "VLWS", "VSWS", "VADD", "VSUB", "VXOR", "VMUL", "VREDSUM", "VREDXOR", "EOP", "NOP"};
 
-/* =============================================================
-
-   HELPER FUNCTIONS
-
-   ============================================================= */
-
-
-/* converts integer into array of unsigned char - little indian */
-inline void int2char(unsigned value, unsigned char *buffer){
-	memcpy(buffer, &value, sizeof value);
-}
-
-/* converts array of char into integer - little indian */
-inline unsigned char2int(unsigned char *buffer){
-	unsigned d;
-	memcpy(&d, buffer, sizeof d);
-	return d;
-}
-
-/* implements the ALU operations */
-unsigned alu(opcode_t opcode, unsigned a, unsigned b, unsigned imm, unsigned npc){
-	switch(opcode){
-			case ADD:
-				return (a+b);
-			case ADDI:
-				return(a+imm);
-			case SUB:
-				return(a-b);
-			case SUBI:
-				return(a-imm);
-			case XOR:
-				return(a ^ b);
-			case LW:
-			case SW:
-				return(a + imm);
-			case BEQZ:
-			case BNEZ:
-			case BGTZ:
-			case BGEZ:
-			case BLTZ:
-			case BLEZ:
-			case JUMP:
-				return(npc+imm);
-			default:	
-				return (-1);
-	}
-}
-
-/* returns true if the instruction is a taken branch/jump */
-bool taken_branch(opcode_t opcode, unsigned a){
-        switch(opcode){
-                case BEQZ:
-                        if (a==0) return true;
-                        break;
-                case BNEZ:
-                        if (a!=0) return true;
-                        break;
-                case BGTZ:
-                        if ((int)a>0)  return true;
-                        break;
-                case BGEZ:
-                        if ((int)a>=0) return true;
-                        break;
-                case BLTZ:
-                        if ((int)a<0)  return true;
-                        break;
-                case BLEZ:
-                        if ((int)a<=0) return true;
-                        break;
-                case JUMP:
-                        return true;
-                default:
-                        return false;
-        }
-        return false;
+/* returns the mnemonic of the opcode */
+const char *opcode_name(opcode_t opcode){
+	return instr_names[opcode];
 }
 
-/* return the kind of instruction encoded */ 
-
-bool is_branch(opcode_t opcode){
-        return (opcode == BEQZ || opcode == BNEZ || opcode == BLTZ || opcode == BLEZ || opcode == BGTZ || opcode == BGEZ || opcode == JUMP);
+/* returns the assembly text of the instruction */
+string instr_to_string(const instruction_t &instr){
+	string text = instr_names[instr.opcode];
+	switch(instr.opcode){
+		case ADD:
+		case SUB:
+		case XOR:
+			return text + "\tR" + to_string(instr.dest) + " R" + to_string(instr.src1) + " R" + to_string(instr.src2);
+		case ADDI:
+		case SUBI:
+			return text + "\tR" + to_string(instr.dest) + " R" + to_string(instr.src1) + " " + to_string((int)instr.immediate);
+		case LW:
+			return text + "\tR" + to_string(instr.dest) + " " + to_string((int)instr.immediate) + "(R" + to_string(instr.src1) + ")";
+		case SW:
+			return text + "\tR" + to_string(instr.src2) + " " + to_string((int)instr.immediate) + "(R" + to_string(instr.src1) + ")";
+		case BEQZ:
+		case BNEZ:
+		case BLTZ:
+		case BGTZ:
+		case BLEZ:
+		case BGEZ:
+			return text + "\tR" + to_string(instr.src1) + " " + instr.label;
+		case JUMP:
+			return text + "\t" + instr.label;
+		case VLW:
+			return text + "\tV" + to_string(instr.dest - NUM_GP_REGISTERS) + " " + to_string((int)instr.immediate) + "(R" + to_string(instr.src1) + ")";
+		case VSW:
+			return text + "\tV" + to_string(instr.src2 - NUM_GP_REGISTERS) + " " + to_string((int)instr.immediate) + "(R" + to_string(instr.src1) + ")";
+		case VLWS:
+			return text + "\tV" + to_string(instr.dest - NUM_GP_REGISTERS) + " R" + to_string(instr.src1) + " " + to_string((int)instr.immediate);
+		case VSWS:
+			return text + "\tV" + to_string(instr.src2 - NUM_GP_REGISTERS) + " R" + to_string(instr.src1) + " " + to_string((int)instr.immediate);
+		case VADD:
+		case VSUB:
+		case VXOR:
+		case VMUL:
+			return text + "\tV" + to_string(instr.dest - NUM_GP_REGISTERS) + " V" + to_string(instr.src1 - NUM_GP_REGISTERS) + " V" + to_string(instr.src2 - NUM_GP_REGISTERS);
+		case VREDSUM:
+		case VREDXOR:
+			return text + "\tR" + to_string(instr.dest) + " V" + to_string(instr.src1 - NUM_GP_REGISTERS);
+		default:
+			return text;
+	}
 }
 
-bool is_memory(opcode_t opcode){
-        return (opcode == LW || opcode == SW);
+/* returns the encoding of register token "Ri" (or "Vi" if "vector", see the instruction encoding in sim_pipe.h); clears "valid" if the token is missing or out of range */
+static unsigned register_operand(char *token, bool vector, bool &valid){
+	char *number = token ? strtok(token, vector ? "V" : "R") : NULL;
+	unsigned reg = number ? strtoul(number, NULL, 10) : UNDEFINED;
+	if (reg >= (vector ? NUM_VREGS : NUM_GP_REGISTERS)) {
+		valid = false;
+		return UNDEFINED;
+	}
+	return vector ? NUM_GP_REGISTERS + reg : reg;
 }
 
-bool is_int_r(opcode_t opcode){
-        return (opcode == ADD || opcode == SUB || opcode == XOR);
+static unsigned gp_register(char *token, bool &valid){ return register_operand(token, false, valid); }
+
+static unsigned vector_register(char *token, bool &valid){ return register_operand(token, true, valid); }
+
+/* returns the value of immediate token "token"; clears "valid" if it is missing */
+static unsigned immediate(char *token, bool &valid){
+	if (token == NULL) valid = false;
+	return token ? strtoul(token, NULL, 0) : 0;
 }
 
-bool is_int_imm(opcode_t opcode){
-        return (opcode == ADDI || opcode == SUBI);
+/* parses memory operand token "offset(Ri)": returns the offset and sets "base"; clears "valid" if it is malformed */
+static unsigned memory_operand(char *token, unsigned &base, bool &valid){
+	unsigned offset = immediate(token ? strtok(token, "()") : NULL, valid);
+	base = gp_register(token ? strtok(NULL, "()") : NULL, valid);
+	return offset;
 }
 
 /* =============================================================
@@ -117,11 +101,11 @@ bool is_int_imm(opcode_t opcode){
 
    ============================================================= */
 
-/* loads the assembly program in file "filename" in instruction memory at the specified address */
-void sim_pipe::load_program(const char *filename, unsigned base_address){
+/* parses the assembly program in file "filename"; returns false, with the reason in "error", if it is not a valid program */
+bool read_program(const char *filename, program_t &program, string &error){
 
-   /* initializing the base instruction address */
-   instr_base_address = base_address;
+   program.instructions.clear();
+   program.labels.clear();
 
    /* creating a map with the valid opcodes and with the valid labels */
    map<string, opcode_t> opcodes; //for opcodes
@@ -132,8 +116,8 @@ void sim_pipe::load_program(const char *filename, unsigned base_address){
    /* opening the assembly file */
    ifstream fin(filename, ios::in | ios::binary);
    if (!fin.is_open()) {
-      cerr << "error: open file " << filename << " failed!" << endl;
-      exit(-1);
+      error = "open file " + string(filename) + " failed";
+      return false;
    }
 
    /* parsing the assembly file line by line */
@@ -145,55 +129,73 @@ void sim_pipe::load_program(const char *filename, unsigned base_address){
 
   	// tokenize the instruction
 	char *token = strtok (str," \t");
+	if (token == NULL) continue; // empty line
+	if (instruction_nr == PROGRAM_SIZE) {
+		error = string(filename) + " exceeds " + to_string(PROGRAM_SIZE) + " instructions";
+		return false;
+	}
 	map<string, opcode_t>::iterator search = opcodes.find(token);
         if (search == opcodes.end()){
+		if (token[strlen(token)-1] != ':') {
+			error = "invalid opcode " + string(token) + " (instruction " + to_string(instruction_nr) + ")";
+			return false;
+		}
 		// this is a label for a branch - extract it and save it in the labels map
 		string label = string(token).substr(0, string(token).length() - 1);
 		labels[label]=instruction_nr;
+		program.labels[instruction_nr]=label;
                 // move to next token, which must be the instruction opcode
 		token = strtok (NULL, " \t");
+		if (token == NULL) {
+			error = "missing opcode after label " + label + " (instruction " + to_string(instruction_nr) + ")";
+			return false;
+		}
 		search = opcodes.find(token);
-		if (search == opcodes.end()) cout << "ERROR: invalid opcode: " << token << " !" << endl;
+		if (search == opcodes.end()) {
+			error = "invalid opcode " + string(token) + " (instruction " + to_string(instruction_nr) + ")";
+			return false;
+		}
 	}
-	instr_memory[instruction_nr].opcode = search->second;
+	program.instructions.push_back(instruction_t{NOP, UNDEFINED, UNDEFINED, UNDEFINED, UNDEFINED, ""});
+	instruction_t &instr = program.instructions.back();
+	instr.opcode = search->second;
 
 	//reading remaining parameters
 	char *par1;
 	char *par2;
 	char *par3;
-	switch(instr_memory[instruction_nr].opcode){
+	bool valid = true;
+	switch(instr.opcode){
 		case ADD:
 		case SUB:
 		case XOR:
 			par1 = strtok (NULL, " \t");
 			par2 = strtok (NULL, " \t");
 			par3 = strtok (NULL, " \t");
-			instr_memory[instruction_nr].dest = atoi(strtok(par1, "R"));
-			instr_memory[instruction_nr].src1 = atoi(strtok(par2, "R"));
-			instr_memory[instruction_nr].src2 = atoi(strtok(par3, "R"));
+			instr.dest = gp_register(par1, valid);
+			instr.src1 = gp_register(par2, valid);
+			instr.src2 = gp_register(par3, valid);
 			break;
 		case ADDI:
 		case SUBI:
 			par1 = strtok (NULL, " \t");
 			par2 = strtok (NULL, " \t");
 			par3 = strtok (NULL, " \t");
-			instr_memory[instruction_nr].dest = atoi(strtok(par1, "R"));
-			instr_memory[instruction_nr].src1 = atoi(strtok(par2, "R"));
-			instr_memory[instruction_nr].immediate = strtoul (par3, NULL, 0); 
+			instr.dest = gp_register(par1, valid);
+			instr.src1 = gp_register(par2, valid);
+			instr.immediate = immediate(par3, valid);
 			break;
 		case LW:
 			par1 = strtok (NULL, " \t");
 			par2 = strtok (NULL, " \t");
-			instr_memory[instruction_nr].dest = atoi(strtok(par1, "R"));
-			instr_memory[instruction_nr].immediate = strtoul(strtok(par2, "()"), NULL, 0);
-			instr_memory[instruction_nr].src1 = atoi(strtok(NULL, "R"));
+			instr.dest = gp_register(par1, valid);
+			instr.immediate = memory_operand(par2, instr.src1, valid);
 			break;
 		case SW:
 			par1 = strtok (NULL, " \t");
 			par2 = strtok (NULL, " \t");
-			instr_memory[instruction_nr].src2 = atoi(strtok(par1, "R"));
-			instr_memory[instruction_nr].immediate = strtoul(strtok(par2, "()"), NULL, 0);
-			instr_memory[instruction_nr].src1 = atoi(strtok(NULL, "R"));
+			instr.src2 = gp_register(par1, valid);
+			instr.immediate = memory_operand(par2, instr.src1, valid);
 			break;
 		case BEQZ:
 		case BNEZ:
@@ -203,46 +205,216 @@ void sim_pipe::load_program(const char *filename, unsigned base_address){
 		case BGEZ:
 			par1 = strtok (NULL, " \t");
 			par2 = strtok (NULL, " \t");
-			instr_memory[instruction_nr].src1 = atoi(strtok(par1, "R"));
-			instr_memory[instruction_nr].label = par2;
+			instr.src1 = gp_register(par1, valid);
+			if (par2) instr.label = par2;
+			else valid = false;
 			break;
 		case JUMP:
 			par2 = strtok (NULL, " \t");
-			instr_memory[instruction_nr].label = par2;
+			if (par2) instr.label = par2;
+			else valid = false;
+			break;
+		case VLW:
+		case VSW:
+			par1 = strtok (NULL, " \t");
+			par2 = strtok (NULL, " \t");
+			if (instr.opcode == VLW) instr.dest = vector_register(par1, valid);
+			else instr.src2 = vector_register(par1, valid);
+			instr.immediate = memory_operand(par2, instr.src1, valid);
+			break;
+		case VLWS:
+		case VSWS:
+			par1 = strtok (NULL, " \t");
+			par2 = strtok (NULL, " \t");
+			par3 = strtok (NULL, " \t");
+			if (instr.opcode == VLWS) instr.dest = vector_register(par1, valid);
+			else instr.src2 = vector_register(par1, valid);
+			instr.src1 = gp_register(par2, valid);
+			instr.immediate = immediate(par3, valid);
+			break;
+		case VADD:
+		case VSUB:
+		case VXOR:
+		case VMUL:
+			par1 = strtok (NULL, " \t");
+			par2 = strtok (NULL, " \t");
+			par3 = strtok (NULL, " \t");
+			instr.dest = vector_register(par1, valid);
+			instr.src1 = vector_register(par2, valid);
+			instr.src2 = vector_register(par3, valid);
+			break;
+		case VREDSUM:
+		case VREDXOR:
+			par1 = strtok (NULL, " \t");
+			par2 = strtok (NULL, " \t");
+			instr.dest = gp_register(par1, valid);
+			instr.src1 = vector_register(par2, valid);
+			break;
 		default:
 			break;
 
 	} 
+	if (!valid) {
+		error = "invalid operands of " + string(instr_names[instr.opcode]) + " (instruction " + to_string(instruction_nr) + ")";
+		return false;
+	}
 
 	/* increment instruction number before moving to next line */
 	instruction_nr++;
    }
+   //the simulation ends with EOP: a program without it would run forever
+   bool has_eop = false;
+   for (unsigned i=0; i<program.instructions.size(); i++) has_eop = has_eop || program.instructions[i].opcode == EOP;
+   if (!has_eop) {
+	error = "missing EOP in " + string(filename);
+	return false;
+   }
    //reconstructing the labels of the branch operations
-   int i = 0;
-   while(true){
-   	instruction_t instr = instr_memory[i];
+   for (unsigned i=0; i<program.instructions.size(); i++){
+   	instruction_t &instr = program.instructions[i];
 	if (instr.opcode == EOP) break;
 	if (instr.opcode == BLTZ || instr.opcode == BNEZ ||
             instr.opcode == BGTZ || instr.opcode == BEQZ ||
             instr.opcode == BGEZ || instr.opcode == BLEZ ||
             instr.opcode == JUMP
 	 ){
-		instr_memory[i].immediate = (labels[instr.label] - i - 1) << 2;
+		if (labels.find(instr.label) == labels.end()) {
+			error = "undefined label " + instr.label + " (instruction " + to_string(i) + ")";
+			return false;
+		}
+		instr.immediate = (labels[instr.label] - i - 1) << 2;
 	}
-        i++;
    }
+   return true;
+}
 
-   ProgramCount = instr_base_address;
+/* parses the assembly program in file "filename"; exits if it is not a valid program */
+static void read_program_or_exit(const char *filename, program_t &program){
+	string error;
+	if (!read_program(filename, program, error)) {
+		cerr << "error: " << error << "!" << endl;
+		exit(-1);
+	}
+}
 
+/* loads the assembly program in file "filename" in instruction memory at the specified address */
+void sim_pipe_base::load_program(const char *filename, unsigned base_address){
+	program_t program;
+	read_program_or_exit(filename, program);
+	load_program(program, base_address);
+}
+
+/* loads a program parsed before in instruction memory at the specified address */
+void sim_pipe_base::load_program(const program_t &program, unsigned base_address){
+	instr_base_address = base_address;
+	program_size = program.instructions.size();
+	for (unsigned i=0; i<program_size; i++) instr_memory[i] = program.instructions[i];
+	instr_labels = program.labels;
+	if (program_size > dirty_size) dirty_size = program_size;
+	num_threads = threads_running = 1;
+	threads[0].start = threads[0].ProgramCount = instr_base_address;
+}
+
+/* adds a hardware thread running the program in file "filename" */
+unsigned sim_pipe_base::add_thread(const char *filename){
+	program_t program;
+	read_program_or_exit(filename, program);
+	return add_thread(program);
+}
+
+/* adds a hardware thread: its program goes after the ones loaded before (branch offsets are relative) */
+unsigned sim_pipe_base::add_thread(const program_t &program){
+	if (instr_base_address == UNDEFINED) {
+		cerr << "error: add_thread needs a program loaded with load_program first!" << endl;
+		exit(-1);
+	}
+	if (num_threads == MAX_THREADS || program_size + program.instructions.size() > PROGRAM_SIZE) {
+		cerr << "error: cannot add a hardware thread (" << MAX_THREADS << " threads and " << PROGRAM_SIZE << " instructions at most)!" << endl;
+		exit(-1);
+	}
+	unsigned first = program_size;
+	for (unsigned i=0; i<program.instructions.size(); i++) instr_memory[first + i] = program.instructions[i];
+	for (map<unsigned, string>::const_iterator it = program.labels.begin(); it != program.labels.end(); ++it)
+		instr_labels[first + it->first] = it->second;
+	program_size += program.instructions.size();
+	if (program_size > dirty_size) dirty_size = program_size;
+
+	unsigned t = num_threads++;
+	threads_running++;
+	threads[t].start = threads[t].ProgramCount = instr_base_address + 4*first;
+	return t;
+}
+
+void sim_pipe_base::set_fetch_policy(fetch_policy_t policy){fetch_policy = policy;}
+
+unsigned sim_pipe_base::get_thread_count(){return num_threads;}
+
+/* returns the loaded program */
+void sim_pipe_base::get_program(program_t &program){
+	program.instructions.assign(instr_memory, instr_memory + program_size);
+	program.labels = instr_labels;
 }
 
 /* writes an integer value to data memory at the specified address (use little-endian format: https://en.wikipedia.org/wiki/Endianness) */
-void sim_pipe::write_memory(unsigned address, unsigned value){
+void sim_pipe_base::write_memory(unsigned address, unsigned value){
+	if (!in_data_memory(address)) {
+		cerr << "error: address 0x" << hex << address << dec << " is outside data memory!" << endl;
+		exit(-1);
+	}
 	int2char(value,data_memory+address);
+	page_written[address / SNAPSHOT_PAGE] = true;
+	page_written[(address+3) / SNAPSHOT_PAGE] = true;
+	if (!page_dirty.empty()) {
+		page_dirty[address / SNAPSHOT_PAGE] = true;
+		page_dirty[(address+3) / SNAPSHOT_PAGE] = true;
+	}
+}
+
+/* reads a data memory image ("<address> <value>" pairs); returns false, with the reason in "error", if the file cannot be read */
+bool read_memory_image(const char *filename, memory_image_t &image, string &error){
+
+	ifstream fin(filename, ios::in);
+	if (!fin.is_open()) {
+		error = "open file " + string(filename) + " failed";
+		return false;
+	}
+
+	image.clear();
+	string line;
+	while (getline(fin, line)){
+		if (line.empty() || line[0] == '#') continue;
+		char *end;
+		unsigned address = strtoul(line.c_str(), &end, 0);
+		unsigned value = strtoul(end, NULL, 0);
+		image.push_back(make_pair(address, value));
+	}
+	return true;
+}
+
+/* loads a data memory image ("<address> <value>" pairs) */
+void sim_pipe_base::load_memory(const char *filename){
+	memory_image_t image;
+	string error;
+	if (!read_memory_image(filename, image, error)) {
+		cerr << "error: " << error << "!" << endl;
+		exit(-1);
+	}
+	load_memory(image);
+}
+
+/* loads a data memory image read before */
+void sim_pipe_base::load_memory(const memory_image_t &image){
+	for (unsigned i=0; i<image.size(); i++){
+		if (image[i].first > data_memory_size - 4) {
+			cerr << "error: address 0x" << hex << image[i].first << dec << " of the memory image is outside data memory!" << endl;
+			exit(-1);
+		}
+		write_memory(image[i].first, image[i].second);
+	}
 }
 
 /* prints the content of the data memory within the specified address range */
-void sim_pipe::print_memory(unsigned start_address, unsigned end_address){
+void sim_pipe_base::print_memory(unsigned start_address, unsigned end_address){
 	cout << "data_memory[0x" << hex << setw(8) << setfill('0') << start_address << ":0x" << hex << setw(8) << setfill('0') <<  end_address << "]" << endl;
 	for (unsigned i=start_address; i<end_address; i++){
 		if (i%4 == 0) cout << "0x" << hex << setw(8) << setfill('0') << i << ": "; 
@@ -252,7 +424,7 @@ void sim_pipe::print_memory(unsigned start_address, unsigned end_address){
 }
 
 /* prints the values of the registers */
-void sim_pipe::print_registers(){
+void sim_pipe_base::print_registers(){
         cout << "Special purpose registers:" << endl;
         unsigned i, s;
         for (s=0; s<NUM_STAGES; s++){
@@ -263,29 +435,432 @@ void sim_pipe::print_registers(){
         cout << "General purpose registers:" << endl;
         for (i=0; i< NUM_GP_REGISTERS; i++)
                 if (get_gp_register(i)!=(int)UNDEFINED) cout << "R" << dec << i << " = " << get_gp_register(i) << hex << " / 0x" << get_gp_register(i) << endl;
+	// vector registers: only the ones written, first VL elements
+	for (i=0; i<NUM_VREGS; i++){
+		bool written = false;
+		for (unsigned e=0; e<vector_length; e++) written = written || threads[0].vregs[i][e] != UNDEFINED;
+		if (!written) continue;
+		cout << "V" << dec << i << " =";
+		for (unsigned e=0; e<vector_length; e++) cout << " " << (int)threads[0].vregs[i][e];
+		cout << endl;
+	}
+	// general purpose registers of the other hardware threads
+	for (unsigned t=1; t<num_threads; t++){
+		cout << "Thread " << dec << t << " general purpose registers:" << endl;
+		for (i=0; i< NUM_GP_REGISTERS; i++)
+			if (get_gp_register(t, i)!=(int)UNDEFINED) cout << "R" << dec << i << " = " << get_gp_register(t, i) << hex << " / 0x" << get_gp_register(t, i) << endl;
+	}
+}
+
+/* builds the assembly text and the basic block leaders of the loaded program (used by the profile reports) */
+void sim_pipe_base::annotate_program(string *text, bool *leader){
+	for (unsigned i=0; i<program_size; i++){
+		text[i] = instr_to_string(instr_memory[i]);
+		leader[i] = (i == 0 || instr_labels.count(i) || is_branch(instr_memory[i-1].opcode));
+	}
+}
+
+/* prints the per-PC profile of the loaded program */
+void sim_pipe_base::print_profile(){
+	string *text = new string[program_size];
+	bool *leader = new bool[program_size];
+	annotate_program(text, leader);
+	profile.print(text, program_size, leader, instr_labels, instr_base_address);
+	delete [] text;
+	delete [] leader;
+}
+
+/* writes the per-PC profile of the loaded program in folded-stack format */
+void sim_pipe_base::write_folded_profile(const char *filename){
+	string *text = new string[program_size];
+	bool *leader = new bool[program_size];
+	annotate_program(text, leader);
+	profile.write_folded(filename, text, program_size, leader, instr_labels, instr_base_address);
+	delete [] text;
+	delete [] leader;
 }
 
 /* initializes the pipeline simulator */
-sim_pipe::sim_pipe(unsigned mem_size, unsigned mem_latency){
+sim_pipe_base::sim_pipe_base(unsigned mem_size, unsigned mem_latency) : profile(PROGRAM_SIZE){
+	// classic 5-stage pipeline - sim_pipe_core overrides the mapping for deeper configurations
+	for (int i=0; i<NUM_STAGES-1; i++) latch_of[i] = i;
 	data_memory_size = mem_size;
 	data_memory_latency = mem_latency;
 	data_memory = new unsigned char[data_memory_size];
+	instr_memory = new instruction_t[PROGRAM_SIZE];
+	io_base = UNDEFINED;
+	devices.connect(data_memory, data_memory_size);
+	dirty_size = PROGRAM_SIZE;
+	page_written.assign((data_memory_size + SNAPSHOT_PAGE - 1) / SNAPSHOT_PAGE, true);
+	set_vector_unit(8, 4, 2);
+	fetch_policy = ROUND_ROBIN;
+	snapshot_interval = 0;
+	snapshot_budget = SNAPSHOT_BUDGET;
 	reset();
 }
 	
 /* deallocates the pipeline simulator */
-sim_pipe::~sim_pipe(){
+sim_pipe_base::~sim_pipe_base(){
 	delete [] data_memory;
+	delete [] instr_memory;
 }
 
 /* execution statistics */
-unsigned sim_pipe::get_clock_cycles(){return clock_cycles;}
+unsigned sim_pipe_base::get_clock_cycles(){return clock_cycles;}
+
+unsigned sim_pipe_base::get_instructions_executed(){return instructions_executed;}
+
+unsigned sim_pipe_base::get_stalls(){return stalls;}
+
+float sim_pipe_base::get_IPC(){return (float)instructions_executed/clock_cycles;}
+
+unsigned sim_pipe_base::get_instructions_executed(unsigned thread){return threads[thread].instructions_executed;}
+
+unsigned sim_pipe_base::get_stalls(unsigned thread){return threads[thread].stalls;}
+
+unsigned sim_pipe_base::get_thread_switches(unsigned thread){return threads[thread].switches;}
+
+unsigned sim_pipe_base::get_finish_cycle(unsigned thread){return threads[thread].finish_cycle;}
+
+unsigned sim_pipe_base::get_memory_fault(){return memory_fault;}
+
+unsigned sim_pipe_base::get_memory_fault_pc(){return memory_fault_pc;}
+
+/* prints the per-thread statistics and the aggregate ones */
+void sim_pipe_base::print_thread_statistics(){
+	static const char *policy_names[] = {"round robin", "switch on stall", "ICOUNT"};
+	cout << "Threads = " << dec << num_threads << " (" << policy_names[fetch_policy] << ")" << endl;
+	cout << setfill(' ') << setw(8) << "thread" << setw(14) << "instructions" << setw(10) << "stalls" << setw(10) << "switches" << setw(10) << "finished" << setw(8) << "IPC" << endl;
+	for (unsigned t=0; t<num_threads; t++){
+		unsigned cycles = threads[t].finished ? threads[t].finish_cycle : clock_cycles;
+		cout << setw(8) << t << setw(14) << threads[t].instructions_executed << setw(10) << threads[t].stalls << setw(10) << threads[t].switches;
+		if (threads[t].finished) cout << setw(10) << threads[t].finish_cycle;
+		else cout << setw(10) << "-";
+		cout << setw(8) << fixed << setprecision(3) << (cycles ? (double)threads[t].instructions_executed/cycles : 0.0) << endl;
+	}
+	cout << setw(8) << "all" << setw(14) << instructions_executed << setw(10) << stalls << setw(10) << "" << setw(10) << clock_cycles;
+	cout << setw(8) << (clock_cycles ? (double)instructions_executed/clock_cycles : 0.0) << endl;
+	cout << defaultfloat << setprecision(6);
+}
+
+sim_profile &sim_pipe_base::get_profile(){return profile;}
+
+unsigned sim_pipe_base::get_program_size(){return program_size;}
+
+const instruction_t &sim_pipe_base::get_instruction(unsigned idx){return instr_memory[idx];}
+
+map<unsigned, string> &sim_pipe_base::get_labels(){return instr_labels;}
+
+void sim_pipe_base::set_io_base(unsigned base_address){io_base = base_address;}
+
+unsigned long long sim_pipe_base::get_memory_digest(){
+	sim_hash h;
+	h.add(data_memory, data_memory_size);
+	return h.get();
+}
+
+/* result cache key: everything the final state depends on */
+unsigned long long sim_pipe_base::job_key(unsigned long long config){
+	sim_hash h;
+	h.add(sim_cache::executable_hash());
+	h.add(config);
+	h.add(data_memory_size);
+	h.add(data_memory_latency);
+	h.add(io_base);
+	h.add(vector_length);
+	h.add(vector_lanes);
+	h.add(vector_latency);
+	prefetcher.add_config(h);
+	h.add(instr_base_address);
+	h.add(program_size);
+	for (unsigned i=0; i<program_size; i++){
+		h.add(instr_memory[i].opcode);
+		h.add(instr_memory[i].src1);
+		h.add(instr_memory[i].src2);
+		h.add(instr_memory[i].dest);
+		h.add(instr_memory[i].immediate);
+	}
+	// initial state: the final values set before the run, so the order of the writes does not matter
+	h.add(threads[0].regs, sizeof threads[0].regs);
+	h.add(threads[0].vregs, sizeof threads[0].vregs);
+	for (unsigned p=0; p<page_written.size(); p++){
+		if (!page_written[p]) continue;
+		h.add(p);
+		h.add(&data_memory[p * SNAPSHOT_PAGE], min<unsigned>(SNAPSHOT_PAGE, data_memory_size - p * SNAPSHOT_PAGE));
+	}
+	return h.get();
+}
+
+/* the data memory was all 0xFF at the reset before the run: the pages written since then hold the rest of it */
+bool sim_pipe_base::save_result(sim_result_t &result){
+	if (memory_fault != UNDEFINED) return false;
+	mark_dma_pages();
+	result.pages.clear();
+	for (unsigned p=0; p<page_written.size(); p++)
+		if (page_written[p]) result.pages.push_back(p);
+	if (result.pages.size() > CACHE_MAX_PAGES) return false;
+	result.page_data.assign(result.pages.size() * SNAPSHOT_PAGE, 0xFF);
+	for (unsigned k=0; k<result.pages.size(); k++){
+		unsigned address = result.pages[k] * SNAPSHOT_PAGE;
+		memcpy(&result.page_data[k * SNAPSHOT_PAGE], &data_memory[address], min<unsigned>(SNAPSHOT_PAGE, data_memory_size - address));
+	}
+	result.console = devices.get_console();
+	result.clock_cycles = clock_cycles;
+	result.instructions_executed = instructions_executed;
+	result.stalls = stalls;
+	result.registers.assign(threads[0].regs, threads[0].regs + NUM_REGS);
+	for (unsigned i=0; i<NUM_VREGS; i++)
+		for (unsigned e=0; e<MAX_VL; e++) result.registers.push_back(threads[0].vregs[i][e]);
+
+	// pipeline registers and IR of every latch, then the thread context (a run after a hit ends at once, as after a miss)
+	result.state.clear();
+	for (unsigned i=0; i<MAX_STAGES-1; i++){
+		const unsigned *words = (const unsigned *)&pipelineRegisters[i];
+		result.state.insert(result.state.end(), words, words + LATCH_WORDS);
+		result.state.insert(result.state.end(), {(unsigned)ir[i].opcode, ir[i].src1, ir[i].src2, ir[i].dest, ir[i].immediate});
+	}
+	ThreadContext &thread = threads[0];
+	result.state.insert(result.state.end(), {thread.ProgramCount, thread.fetched_eop, thread.finished, thread.finish_cycle,
+		thread.instructions_executed, thread.stalls, thread.switches, threads_running, is_stall, (unsigned)stall_cause});
+	profile.save(program_size, result.profile);
+	result.memory_digest = get_memory_digest();
+	return true;
+}
+
+bool sim_pipe_base::restore_result(const sim_result_t &result){
+	if (result.page_data.size() != result.pages.size() * SNAPSHOT_PAGE) return false;
+	for (unsigned k=0; k<result.pages.size(); k++)
+		if (result.pages[k] >= page_written.size()) return false;
+	vector<unsigned> counters;
+	profile.save(program_size, counters);
+	if (result.state.size() != (MAX_STAGES-1) * (LATCH_WORDS+5) + 10 || result.profile.size() != counters.size()) return false;
+	for (unsigned k=0; k<result.pages.size(); k++){
+		unsigned address = result.pages[k] * SNAPSHOT_PAGE;
+		memcpy(&data_memory[address], &result.page_data[k * SNAPSHOT_PAGE], min<unsigned>(SNAPSHOT_PAGE, data_memory_size - address));
+		page_written[result.pages[k]] = true;
+		if (!page_dirty.empty()) page_dirty[result.pages[k]] = true;
+	}
+	devices.set_console(result.console);
+	clock_cycles = result.clock_cycles;
+	instructions_executed = result.instructions_executed;
+	stalls = result.stalls;
+	for (unsigned i=0; i<NUM_REGS && i<result.registers.size(); i++) threads[0].regs[i] = result.registers[i];
+	for (unsigned i=NUM_REGS; i<NUM_REGS + NUM_VREGS*MAX_VL && i<result.registers.size(); i++)
+		threads[0].vregs[(i-NUM_REGS) / MAX_VL][(i-NUM_REGS) % MAX_VL] = result.registers[i];
+
+	const unsigned *state = result.state.data();
+	for (unsigned i=0; i<MAX_STAGES-1; i++, state += LATCH_WORDS+5){
+		memcpy(&pipelineRegisters[i], state, sizeof(PipelineStage));
+		ir[i].opcode = (opcode_t)state[LATCH_WORDS];
+		ir[i].src1 = state[LATCH_WORDS+1];
+		ir[i].src2 = state[LATCH_WORDS+2];
+		ir[i].dest = state[LATCH_WORDS+3];
+		ir[i].immediate = state[LATCH_WORDS+4];
+	}
+	ThreadContext &thread = threads[0];
+	thread.ProgramCount = state[0];
+	thread.fetched_eop = state[1];
+	thread.finished = state[2];
+	thread.finish_cycle = state[3];
+	thread.instructions_executed = state[4];
+	thread.stalls = state[5];
+	thread.switches = state[6];
+	threads_running = state[7];
+	is_stall = state[8];
+	stall_cause = (stall_cause_t)state[9];
+	profile.restore(program_size, result.profile);
+	return true;
+}
+
+sim_devices &sim_pipe_base::get_devices(){return devices;}
+
+void sim_pipe_base::set_prefetcher(prefetch_kind_t kind, unsigned degree, unsigned distance, unsigned queue_size, unsigned buffer_size, unsigned block){
+	prefetcher.configure(kind, degree, distance, queue_size, buffer_size, block, data_memory_size);
+}
+
+sim_prefetcher &sim_pipe_base::get_prefetcher(){return prefetcher;}
+
+/* =============================================================
+
+   SNAPSHOTS
+
+   ============================================================= */
+
+void sim_pipe_base::set_snapshots(unsigned interval, unsigned long long budget){
+	snapshots.clear();
+	snapshot_memory = 0;
+	snapshot_interval = interval;
+	snapshot_budget = budget;
+	if (interval == 0) {
+		page_dirty.clear();
+		next_snapshot = UNDEFINED;
+	} else {
+		page_dirty.assign((data_memory_size + SNAPSHOT_PAGE - 1) / SNAPSHOT_PAGE, false);
+		next_snapshot = clock_cycles;
+	}
+}
+
+unsigned sim_pipe_base::get_snapshot_count(){return snapshots.size();}
+
+unsigned long long sim_pipe_base::get_snapshot_memory(){return snapshot_memory;}
+
+unsigned long long sim_pipe_base::snapshot_bytes(Snapshot &s){
+	return sizeof(Snapshot) + (s.profile.size() + s.replay.size())*sizeof(unsigned) + s.pages.size()*sizeof(unsigned) + s.page_data.size() + s.devices.get_console().size();
+}
+
+/* the DMA engine writes the data memory directly: its destination range counts as written */
+void sim_pipe_base::mark_dma_pages(){
+	unsigned begin, end;
+	devices.get_dma_dirty(begin, end);
+	if (begin < end)
+		for (unsigned p = begin / SNAPSHOT_PAGE; p <= (end-1) / SNAPSHOT_PAGE; p++){
+			page_written[p] = true;
+			if (!page_dirty.empty()) page_dirty[p] = true;
+		}
+}
+
+void sim_pipe_base::take_snapshot(){
+
+	snapshots.push_back(Snapshot());
+	Snapshot &s = snapshots.back();
+	s.cycle = clock_cycles;
+	s.stalls = stalls;
+	s.instructions_executed = instructions_executed;
+	memcpy(s.threads, threads, sizeof threads);
+	s.threads_running = threads_running;
+	s.fetch_thread = fetch_thread;
+	s.is_stall = is_stall;
+	s.stall_cause = stall_cause;
+	s.frontend_advance = frontend_advance;
+	s.port_free = port_free;
+	s.mem_done = mem_done;
+	s.mem_stall = mem_stall;
+	s.vector_done = vector_done;
+	s.ex_stall = ex_stall;
+	memcpy(s.vresults, vresults, sizeof vresults);
+	s.next_vresult = next_vresult;
+	for (unsigned i=0; i<MAX_STAGES-1; i++){
+		s.pipelineRegisters[i] = pipelineRegisters[i];
+		s.ir[i] = ir[i];
+	}
+	mark_dma_pages();
+	s.devices = devices;
+	s.prefetcher = prefetcher;
+	profile.save(program_size, s.profile);
+
+	// data memory: the pages written since the previous snapshot, all of them in the first one
+	bool first = (snapshots.size() == 1);
+	for (unsigned p=0; p<page_dirty.size(); p++){
+		if (first || page_dirty[p]) s.pages.push_back(p);
+		page_dirty[p] = false;
+	}
+	s.page_data.resize(s.pages.size() * SNAPSHOT_PAGE);
+	for (unsigned k=0; k<s.pages.size(); k++){
+		unsigned address = s.pages[k] * SNAPSHOT_PAGE;
+		memcpy(&s.page_data[k * SNAPSHOT_PAGE], &data_memory[address], min<unsigned>(SNAPSHOT_PAGE, data_memory_size - address));
+	}
+
+	snapshot_memory += snapshot_bytes(s);
+	next_snapshot = clock_cycles + snapshot_interval;
+	while (snapshot_memory > snapshot_budget && snapshots.size() > 2) thin_snapshots();
+}
+
+void sim_pipe_base::thin_snapshots(){
+
+	vector<Snapshot> kept;
+	kept.reserve(snapshots.size()/2 + 2);
+	kept.push_back(move(snapshots[0]));
+	for (unsigned i=1; i<snapshots.size(); i++){
+		if (i % 2 == 0 || i == snapshots.size()-1) {
+			kept.push_back(move(snapshots[i]));
+			continue;
+		}
+		// snapshot i is dropped: the pages the next one does not hold had the same content then
+		Snapshot &a = snapshots[i], &b = snapshots[i+1];
+		vector<unsigned> pages;
+		vector<unsigned char> data;
+		unsigned ka = 0, kb = 0;
+		while (ka < a.pages.size() || kb < b.pages.size()){
+			bool from_b = kb < b.pages.size() && (ka == a.pages.size() || b.pages[kb] <= a.pages[ka]);
+			if (from_b && ka < a.pages.size() && a.pages[ka] == b.pages[kb]) ka++;
+			Snapshot &src = from_b ? b : a;
+			unsigned &k = from_b ? kb : ka;
+			pages.push_back(src.pages[k]);
+			data.insert(data.end(), src.page_data.begin() + k*SNAPSHOT_PAGE, src.page_data.begin() + (k+1)*SNAPSHOT_PAGE);
+			k++;
+		}
+		b.pages.swap(pages);
+		b.page_data.swap(data);
+	}
+	snapshots.swap(kept);
+
+	snapshot_memory = 0;
+	for (unsigned i=0; i<snapshots.size(); i++) snapshot_memory += snapshot_bytes(snapshots[i]);
+	if (snapshot_interval < 0x80000000) snapshot_interval *= 2;
+	next_snapshot = snapshots.back().cycle + snapshot_interval;
+}
 
-unsigned sim_pipe::get_instructions_executed(){return instructions_executed;}
+unsigned sim_pipe_base::find_snapshot(unsigned cycle){
+	for (unsigned i=snapshots.size(); i>0; i--)
+		if (snapshots[i-1].cycle <= cycle) return i-1;
+	return UNDEFINED;
+}
 
-unsigned sim_pipe::get_stalls(){return stalls;}
+void sim_pipe_base::restore_snapshot(unsigned idx){
+
+	// pages written after the snapshot: the ones of the later snapshots and the ones written since the last
+	mark_dma_pages();
+	vector<bool> stale(page_dirty);
+	for (unsigned j=idx+1; j<snapshots.size(); j++)
+		for (unsigned k=0; k<snapshots[j].pages.size(); k++) stale[snapshots[j].pages[k]] = true;
+
+	// each of them gets its content from the last snapshot before that holds it (the first one holds all)
+	for (unsigned j=idx+1; j>0; j--){
+		Snapshot &s = snapshots[j-1];
+		for (unsigned k=0; k<s.pages.size(); k++){
+			unsigned p = s.pages[k];
+			if (!stale[p]) continue;
+			unsigned address = p * SNAPSHOT_PAGE;
+			memcpy(&data_memory[address], &s.page_data[k * SNAPSHOT_PAGE], min<unsigned>(SNAPSHOT_PAGE, data_memory_size - address));
+			stale[p] = false;
+		}
+	}
 
-float sim_pipe::get_IPC(){return (float)instructions_executed/clock_cycles;}
+	// (the snapshots are taken before the run stops on a memory fault)
+	Snapshot &s = snapshots[idx];
+	clock_cycles = s.cycle;
+	memory_fault = memory_fault_pc = UNDEFINED;
+	stalls = s.stalls;
+	instructions_executed = s.instructions_executed;
+	memcpy(threads, s.threads, sizeof threads);
+	threads_running = s.threads_running;
+	fetch_thread = s.fetch_thread;
+	is_stall = s.is_stall;
+	stall_cause = s.stall_cause;
+	frontend_advance = s.frontend_advance;
+	port_free = s.port_free;
+	mem_done = s.mem_done;
+	mem_stall = s.mem_stall;
+	vector_done = s.vector_done;
+	ex_stall = s.ex_stall;
+	memcpy(vresults, s.vresults, sizeof vresults);
+	next_vresult = s.next_vresult;
+	for (unsigned i=0; i<MAX_STAGES-1; i++){
+		pipelineRegisters[i] = s.pipelineRegisters[i];
+		ir[i] = s.ir[i];
+	}
+	devices = s.devices;
+	prefetcher = s.prefetcher;
+	profile.restore(program_size, s.profile);
+
+	// the simulation takes the later snapshots again
+	while (snapshots.size() > idx+1){
+		snapshot_memory -= snapshot_bytes(snapshots.back());
+		snapshots.pop_back();
+	}
+	page_dirty.assign(page_dirty.size(), false);
+	next_snapshot = clock_cycles + snapshot_interval;
+}
                                 
 /* =============================================================
 
@@ -295,13 +870,18 @@ float sim_pipe::get_IPC(){return (float)instructions_executed/clock_cycles;}
 
 
 /* reset the state of the pipeline simulator */
-void sim_pipe::reset(){
-
-	// initializing data memory to all 0xFF
-	for (unsigned i=0; i<data_memory_size; i++) data_memory[i]=0xFF;
+void sim_pipe_base::reset(){
+
+	// initializing data memory to all 0xFF - only the pages written since the previous reset are restored
+	mark_dma_pages();
+	for (unsigned p=0; p<page_written.size(); p++){
+		if (!page_written[p]) continue;
+		memset(&data_memory[p * SNAPSHOT_PAGE], 0xFF, min<unsigned>(SNAPSHOT_PAGE, data_memory_size - p * SNAPSHOT_PAGE));
+		page_written[p] = false;
+	}
 
-	// initializing instuction memory
-        for (int i=0; i<PROGRAM_SIZE;i++){
+	// initializing instuction memory - the entries after the ones written by load_program are never modified
+        for (unsigned i=0; i<dirty_size;i++){
                 instr_memory[i].opcode=(opcode_t)NOP;
                 instr_memory[i].src1=UNDEFINED;
                 instr_memory[i].src2=UNDEFINED;
@@ -309,14 +889,27 @@ void sim_pipe::reset(){
                 instr_memory[i].immediate=UNDEFINED;
         }
 	instr_base_address = UNDEFINED;
+	program_size = 0;
+	instr_labels.clear();
 
-	// general purpose registers initialization
-	for (int i = 0; i<NUM_REGS; i++){
-		regs[i] = UNDEFINED;
+	// hardware threads initialization: one thread, general purpose and vector registers
+	for (int t = 0; t<MAX_THREADS; t++){
+		for (int i = 0; i<NUM_REGS; i++){
+			threads[t].regs[i] = UNDEFINED;
+		}
+		for (int i = 0; i<NUM_VREGS; i++)
+			for (int e = 0; e<MAX_VL; e++) threads[t].vregs[i][e] = UNDEFINED;
+		threads[t].ProgramCount = threads[t].start = UNDEFINED;
+		threads[t].fetched_eop = threads[t].finished = false;
+		threads[t].finish_cycle = UNDEFINED;
+		threads[t].instructions_executed = threads[t].stalls = threads[t].switches = 0;
 	}
+	num_threads = threads_running = 1;
+	fetch_thread = 0;
+	next_vresult = 0;
 
 	// pipeline registers initialization
-	for (int i = 0; i<NUM_STAGES-1; i++) {
+	for (int i = 0; i<MAX_STAGES-1; i++) {
 		
 		pipelineRegisters[i].pc = UNDEFINED;
 		pipelineRegisters[i].npc = UNDEFINED;
@@ -326,11 +919,12 @@ void sim_pipe::reset(){
 		pipelineRegisters[i].lmd = UNDEFINED;
 		pipelineRegisters[i].alu_out = UNDEFINED;
 		pipelineRegisters[i].cond = UNDEFINED;
+		pipelineRegisters[i].thread = 0;
 
 	}
 
 	// IR initialization
-	for (int i=0; i<NUM_STAGES-1; i++){
+	for (int i=0; i<MAX_STAGES-1; i++){
 		ir[i].opcode=(opcode_t)NOP;
 		ir[i].src1=UNDEFINED;
 		ir[i].src2=UNDEFINED;
@@ -340,18 +934,34 @@ void sim_pipe::reset(){
 
 	// other required initializations (statistics, etc.)
 	clock_cycles = 0; //clock cycles
+	memory_fault = memory_fault_pc = UNDEFINED;
 	stalls = 0; //stalls
 	instructions_executed = 0; //instruction count
 	is_stall = false; //stall flag
+	stall_cause = STALL_RAW;
+	port_free = 0; //memory port
+	mem_done = UNDEFINED;
+	mem_stall = false;
+	vector_done = UNDEFINED; //vector unit
+	ex_stall = false;
+	profile.reset(dirty_size); //per-PC profile
+	dirty_size = 0;
+	devices.reset(); //memory-mapped devices
+	prefetcher.reset(); //data prefetcher (the configuration is kept)
+	frontend_advance = true;
+	snapshots.clear(); //snapshots (the interval and the budget are kept)
+	snapshot_memory = 0;
+	next_snapshot = snapshot_interval ? 0 : UNDEFINED;
+	page_dirty.assign(page_dirty.size(), false);
 }
 
 //returns value of special purpose register (see sim_pipe.h for more details)
-unsigned sim_pipe::get_sp_register(sp_register_t reg, stage_t s){
+unsigned sim_pipe_base::get_sp_register(sp_register_t reg, stage_t s){
 	
 	switch(s){
 		case IF:
 			if (reg == PC){
-				return ProgramCount;
+				return threads[0].ProgramCount;
 			}
 			else {
 				return UNDEFINED;
@@ -359,23 +969,23 @@ unsigned sim_pipe::get_sp_register(sp_register_t reg, stage_t s){
 			break;
 		case ID:
 			if (reg == NPC){
-				return pipelineRegisters[IF_ID].npc;
+				return pipelineRegisters[latch_of[IF_ID]].npc;
 			}
 			else {
 				return UNDEFINED;
 			}
 		case EXE:
 			if (reg == NPC){
-				return pipelineRegisters[ID_EXE].npc;
+				return pipelineRegisters[latch_of[ID_EXE]].npc;
 			}
 			else if (reg == A){
-				return pipelineRegisters[ID_EXE].a;
+				return pipelineRegisters[latch_of[ID_EXE]].a;
 			}
 			else if (reg == B){
-				return pipelineRegisters[ID_EXE].b;
+				return pipelineRegisters[latch_of[ID_EXE]].b;
 			}
 			else if (reg == IMM){
-				return pipelineRegisters[ID_EXE].imm;
+				return pipelineRegisters[latch_of[ID_EXE]].imm;
 			}
 			else {
 				return UNDEFINED;
@@ -383,10 +993,10 @@ unsigned sim_pipe::get_sp_register(sp_register_t reg, stage_t s){
 		case MEM:
 
 			if (reg == ALU_OUTPUT){
-				return pipelineRegisters[EXE_MEM].alu_out;
+				return pipelineRegisters[latch_of[EXE_MEM]].alu_out;
 			}
 			else if (reg == B){
-				return pipelineRegisters[EXE_MEM].b;
+				return pipelineRegisters[latch_of[EXE_MEM]].b;
 			}
 			
 			else {
@@ -395,10 +1005,10 @@ unsigned sim_pipe::get_sp_register(sp_register_t reg, stage_t s){
 			
 		case WB:
 			if (reg == ALU_OUTPUT){
-				return pipelineRegisters[MEM_WB].alu_out;
+				return pipelineRegisters[latch_of[MEM_WB]].alu_out;
 			}
 			else if (reg == LMD){
-				return pipelineRegisters[MEM_WB].lmd;
+				return pipelineRegisters[latch_of[MEM_WB]].lmd;
 			}
 			else {
 				return UNDEFINED;
@@ -408,269 +1018,46 @@ unsigned sim_pipe::get_sp_register(sp_register_t reg, stage_t s){
 }
 
 //returns value of general purpose register
-int sim_pipe::get_gp_register(unsigned reg){
-	return regs[reg];
+int sim_pipe_base::get_gp_register(unsigned reg){
+	return threads[0].regs[reg];
 }
 
 //sets the value of referenced general purpose register
-void sim_pipe::set_gp_register(unsigned reg, int value){
-	 regs[reg] = value;
+void sim_pipe_base::set_gp_register(unsigned reg, int value){
+	set_gp_register(0, reg, value);
 }
 
-/* <TODO: BODY OF THE SIMULATOR */
-// Note: processing the stages in reverse order simplifies the data propagation through pipeline registers
-void sim_pipe::run(unsigned cycles){
-
-	unsigned start_cycles = clock_cycles;
-
-	/* initialization at the beginning of simulation */
-	if (clock_cycles == 0){
-		ProgramCount = instr_base_address;
-	}
-
-	pipelineRegisters[IF_ID].pc = ProgramCount;
-
-	/* ====== MAIN SIMULATION LOOP (one iteration per clock cycle)  ========= */
-	while(cycles==0 || clock_cycles-start_cycles!=cycles){
-
-                /* =============== */
-                /* PIPELINE STAGES */
-                /* =============== */
-		/* ============   WB stage   ============  */
-			// <hint: the simulation loop should be exited when the instruction processed is EOP>
-		
-		if (ir[MEM_WB].opcode == EOP){
-			break;
-		} 
-
-		write_back();
-
-		/* ============   MEM stage   ===========  */
-		memory_stage();
-		/* ============   EXE stage   ===========  */
-			// <suggestion: use "alu" and "taken_branch" helper functions above to update ALU_OUTPUT and COND registers>
-
-		execute_stage();
-
-		/* ============   ID stage   ============  */
-			// <suggestion: use the helper functions "is_branch", "is_int_r", ..., above to improve code readability/compactness>
-
-		instruction_decode();
-
-		/* ============   IF stage   ============  */
-
-		instruction_fetch();
-
-		
-
-
-                /* =============== */
-                /* END STAGES      */
-                /* =============== */
-
-		/* Other bookkeeping code */
-                /* ====================== */
-
-		clock_cycles++; // increase clock cycles count
-
-	}
+//returns value of general purpose register of a hardware thread
+int sim_pipe_base::get_gp_register(unsigned thread, unsigned reg){
+	return threads[thread].regs[reg];
 }
 
-void sim_pipe::instruction_fetch() {
-    
-	ir[IF_ID] = instr_memory[(ProgramCount-instr_base_address)>>2];
-	// Fetch the instruction from memory at the current program counter (PC)
-
-	pipelineRegisters[IF_ID].npc = ProgramCount;
-
-	
-	if (ir[IF_ID].opcode != EOP && ir[IF_ID].opcode != NOP && !is_stall){
-		ProgramCount += 4;
-		pipelineRegisters[IF_ID].npc = ProgramCount;
-
-	}
-
+//sets the value of referenced general purpose register of a hardware thread
+void sim_pipe_base::set_gp_register(unsigned thread, unsigned reg, int value){
+	threads[thread].regs[reg] = value;
 }
 
-void sim_pipe::instruction_decode() {
-	
-	//retrieve instruction from IR
-
-	unsigned rs1 = ir[IF_ID].src1;
-	unsigned rs2 = ir[IF_ID].src2;
-	unsigned immediate = ir[IF_ID].immediate;
-	opcode_t opcode = ir[IF_ID].opcode;
-	unsigned dest = ir[IF_ID].dest;
-	
-
-	if(!is_stall){
-		if(opcode == NOP){
-			pipelineRegisters[ID_EXE].a = UNDEFINED;
-			pipelineRegisters[ID_EXE].b = UNDEFINED;
-			pipelineRegisters[ID_EXE].imm = UNDEFINED;
-		}
-
-		// read operand values & load next pipeline register
-		else if (opcode == LW){
-			pipelineRegisters[ID_EXE].a = get_gp_register(rs1);
-			pipelineRegisters[ID_EXE].imm = immediate;
-			pipelineRegisters[ID_EXE].b = UNDEFINED;
-		}
-		else if (opcode == SW){
-			pipelineRegisters[ID_EXE].a = get_gp_register(rs1);
-			pipelineRegisters[ID_EXE].b = get_gp_register(rs2);
-			pipelineRegisters[ID_EXE].imm = immediate;
-		}
-		else if (is_branch(ir[IF_ID].opcode) == true) {
-			pipelineRegisters[ID_EXE].a = get_gp_register(rs1);
-			pipelineRegisters[ID_EXE].imm = immediate;
-			pipelineRegisters[ID_EXE].b = UNDEFINED;
-		} 
-		else if (opcode == ADDI || opcode == SUBI) {
-			pipelineRegisters[ID_EXE].a = get_gp_register(rs1);
-			pipelineRegisters[ID_EXE].imm = immediate;
-			pipelineRegisters[ID_EXE].b = UNDEFINED;
-		}
-		else if (opcode == EOP){
-			pipelineRegisters[ID_EXE].a = UNDEFINED;
-			pipelineRegisters[ID_EXE].b = UNDEFINED;
-			pipelineRegisters[ID_EXE].imm = UNDEFINED;
-
-		} else {
-			pipelineRegisters[ID_EXE].a = get_gp_register(rs1); // pull value from register files
-			pipelineRegisters[ID_EXE].b = get_gp_register(rs2);
-			pipelineRegisters[ID_EXE].imm = UNDEFINED;
-
-		}
-
-		
-		if (opcode != EOP && opcode != NOP && !is_stall){
-			instructions_executed++;
-		}
-		
-		//pass instruction to the ID/EX pipeline register
-		pipelineRegisters[ID_EXE].imm = immediate;
-		ir[ID_EXE] = ir[IF_ID];
-	} else {
-		
-		//stall
-		stalls++;
-		
-	}
-
-	// TO DO look for RAW stall conditions
-	if(is_int_imm(ir[ID_EXE].opcode) && (ir[ID_EXE].src1 == ir[EXE_MEM].dest || ir[ID_EXE].src1 == ir[MEM_WB].dest)){
-		is_stall = true;
-		pipelineRegisters[ID_EXE].npc = UNDEFINED;
-		pipelineRegisters[ID_EXE].a = UNDEFINED;
-		pipelineRegisters[ID_EXE].b = UNDEFINED;
-		pipelineRegisters[ID_EXE].imm = UNDEFINED;
-		// ir[ID_EXE].opcode = NOP;
-		// ir[ID_EXE].src1 = UNDEFINED;
-		// ir[ID_EXE].src2 = UNDEFINED;
-		// ir[ID_EXE].dest = UNDEFINED;
-		// ir[ID_EXE].immediate = UNDEFINED;
-		return;
-	}
-	else if(is_int_r(ir[ID_EXE].opcode) && (ir[ID_EXE].src1 == ir[EXE_MEM].dest || ir[ID_EXE].src2 == ir[EXE_MEM].dest || ir[ID_EXE].src1 == ir[MEM_WB].dest || ir[ID_EXE].src2 == ir[MEM_WB].dest)){
-		is_stall = true;
-		pipelineRegisters[ID_EXE].npc = UNDEFINED;
-		pipelineRegisters[ID_EXE].a = UNDEFINED;
-		pipelineRegisters[ID_EXE].b = UNDEFINED;
-		pipelineRegisters[ID_EXE].imm = UNDEFINED;
-		// ir[ID_EXE].opcode = NOP;
-		// ir[ID_EXE].src1 = UNDEFINED;
-		// ir[ID_EXE].src2 = UNDEFINED;
-		// ir[ID_EXE].dest = UNDEFINED;
-		// ir[ID_EXE].immediate = UNDEFINED;
-		return;
-
-	} else {
-		
-		is_stall = false;
-
-	}
-
-	pipelineRegisters[ID_EXE].npc = pipelineRegisters[IF_ID].npc;
-
+//returns element "element" of vector register "reg"
+unsigned sim_pipe_base::get_vector_register(unsigned reg, unsigned element){
+	return threads[0].vregs[reg][element];
 }
 
-void sim_pipe::execute_stage() {
-
-	unsigned A = pipelineRegisters[ID_EXE].a;
-	unsigned B = pipelineRegisters[ID_EXE].b;		
-	unsigned immediate = pipelineRegisters[ID_EXE].imm;
-	unsigned npc = pipelineRegisters[ID_EXE].npc;
-	instruction_t instruction = ir[ID_EXE];
-
-	unsigned alu_result = alu(instruction.opcode, A, B, immediate, npc);
-
-
-	if(!is_stall){	
-		//recieve instruction and operands from pipeline register
-		
-	
-		//check if branch TO DO
-		bool is_taken_branch = taken_branch(instruction.opcode, A);
-		
-		pipelineRegisters[EXE_MEM].alu_out = alu_result;
-		pipelineRegisters[EXE_MEM].b = pipelineRegisters[ID_EXE].b;
-
-		pipelineRegisters[EXE_MEM].cond = is_taken_branch;
-
-		ir[EXE_MEM] = ir[ID_EXE];
-
-
-	} else {
-		ir[EXE_MEM].opcode = NOP;
-		ir[EXE_MEM].src1 = UNDEFINED;
-		ir[EXE_MEM].src2 = UNDEFINED;
-		ir[EXE_MEM].dest = UNDEFINED;
-		ir[EXE_MEM].immediate = UNDEFINED;
-		pipelineRegisters[EXE_MEM].alu_out = UNDEFINED;
-		pipelineRegisters[EXE_MEM].b = UNDEFINED;
-
-	}
-}	
-
-void sim_pipe::memory_stage(){
-
-	unsigned ALUOutput = pipelineRegisters[EXE_MEM].alu_out;
-	instruction_t instruction = ir[EXE_MEM];
-
-	if (instruction.opcode == LW) {
-		unsigned LMD = char2int(&data_memory[ALUOutput]);
-		pipelineRegisters[MEM_WB].lmd = LMD;
-		pipelineRegisters[MEM_WB].alu_out = ALUOutput;
-	}
-	else if (instruction.opcode == SW){
-		write_memory(ALUOutput, pipelineRegisters[EXE_MEM].b);
-		pipelineRegisters[MEM_WB].lmd = UNDEFINED;
-		pipelineRegisters[MEM_WB].alu_out = ALUOutput;
-	} 
-	else {
-		pipelineRegisters[MEM_WB].alu_out = ALUOutput;
-		pipelineRegisters[MEM_WB].lmd = UNDEFINED;
-	}
-
-	ir[MEM_WB] = ir[EXE_MEM];
-
+//sets element "element" of vector register "reg"
+void sim_pipe_base::set_vector_register(unsigned reg, unsigned element, unsigned value){
+	threads[0].vregs[reg][element] = value;
 }
 
-void sim_pipe::write_back(){
-
-	unsigned ALUOut = pipelineRegisters[MEM_WB].alu_out;
-	instruction_t instruction = ir[MEM_WB];
-	unsigned LMD = pipelineRegisters[MEM_WB].lmd;
-	unsigned dest = instruction.dest;
-
-	if (instruction.opcode == NOP){
-		return;
-	}
-	else if (instruction.opcode == LW) {
-		regs[dest] = LMD;
-	}	
-	else if (instruction.opcode != SW) {
-		regs[dest] = ALUOut;
+//configures the vector unit
+void sim_pipe_base::set_vector_unit(unsigned length, unsigned lanes, unsigned latency){
+	if (length < 1 || length > MAX_VL || lanes < 1 || latency < 1) {
+		cerr << "error: invalid vector unit (length " << length << ", lanes " << lanes << ", latency " << latency << ")!" << endl;
+		exit(-1);
 	}
+	vector_length = length;
+	vector_lanes = lanes;
+	vector_latency = latency;
+	for (unsigned e=0; e<MAX_VL; e++) vector_mask[e] = (e < length) ? 0xFFFFFFFF : 0;
 }
+
+// the simulator without observer
+template class sim_pipe_core<null_observer, classic_pipeline>;
@@ -5,25 +5,49 @@
 
 #include <stdio.h>
 #include <string>
+#include <map>
+#include <vector>
+#include <type_traits>
+#include "sim_profile.h"
+#include "sim_devices.h"
+#include "sim_prefetch.h"
+#include "sim_trace.h"
+#include "sim_cache.h"
 
 using namespace std;
 
-#define PROGRAM_SIZE 50
+#define PROGRAM_SIZE 65536 // maximum number of instructions of a program
 
 #define UNDEFINED 0xFFFFFFFF //used to initialize the registers
 #define NUM_SP_REGISTERS 9
 #define NUM_GP_REGISTERS 32
-#define NUM_OPCODES 16 
-#define NUM_STAGES 5
+#define NUM_OPCODES 26
+#define NUM_VREGS 8 // vector registers V0-V7
+#define MAX_VL 16 // maximum vector length (32-bit elements)
+#define NUM_STAGES 5 // functional stages: IF, ID, EX, MEM, WB
+#define MAX_STAGES 12 // maximum pipeline depth (see pipeline configurations below)
+#define LATCH_WORDS 9 // words of a pipeline register: pc, npc, a, b, imm, lmd, alu_out, cond, thread
+#define MAX_THREADS 4 // hardware thread contexts
+#define SNAPSHOT_PAGE 4096 // size in bytes of the data memory pages saved by the snapshots
+#define SNAPSHOT_BUDGET (64ULL*1024*1024) // default memory budget of the snapshots (bytes)
+#define CACHE_MAX_PAGES 256 // results writing more data memory pages (SNAPSHOT_PAGE bytes) are not cached
 
 typedef enum {PC, NPC, IR, A, B, IMM, COND, ALU_OUTPUT, LMD} sp_register_t;
 
-typedef enum {LW, SW, ADD, ADDI, SUB, SUBI, XOR, BEQZ, BNEZ, BLTZ, BGTZ, BLEZ, BGEZ, JUMP, EOP, NOP} opcode_t;
+typedef enum {LW, SW, ADD, ADDI, SUB, SUBI, XOR, BEQZ, BNEZ, BLTZ, BGTZ, BLEZ, BGEZ, JUMP,
+	VLW, VSW, VLWS, VSWS, VADD, VSUB, VXOR, VMUL, VREDSUM, VREDXOR, EOP, NOP} opcode_t;
 
 typedef enum {IF, ID, EXE, MEM, WB} stage_t;
 
 typedef enum {IF_ID, ID_EXE, EXE_MEM, MEM_WB} pipelinestage_t;
 
+//thread IF fetches from when several hardware threads run (see add_thread)
+typedef enum {
+	ROUND_ROBIN, //barrel: the next thread every cycle
+	SWITCH_ON_STALL, //the same thread until one of its instructions stalls in ID (it is squashed and fetched again later)
+	ICOUNT //the thread with the fewest instructions in the pipeline
+} fetch_policy_t;
+
 /*
 Instruction encoding:
 ADD <dest> <src1> <src2>
@@ -31,6 +55,15 @@ ADDI <dest> <src1> <immediate>
 LW <dest> <immediate>(<src1>)
 SW <src2> <immediate>(<src1>)
 BRANCH <src1> <immediate>
+
+Vector instructions operate on the first VL elements of the vector registers (see set_vector_unit):
+VLW <dest> <immediate>(<src1>)    unit-stride load of VL words
+VSW <src2> <immediate>(<src1>)    unit-stride store of VL words
+VLWS <dest> <src1> <immediate>    strided load: element i at src1 + i*immediate
+VSWS <src2> <src1> <immediate>    strided store
+VADD/VSUB/VXOR/VMUL <dest> <src1> <src2>    element-wise (VMUL keeps the low 32 bits)
+VREDSUM/VREDXOR <dest> <src1>     reduction of vector src1 into scalar dest
+Vector register Vi is encoded as NUM_GP_REGISTERS+i in src1/src2/dest, so the hazard checks cover it.
 */
 
 typedef struct{
@@ -42,15 +75,200 @@ typedef struct{
         string label; //for conditional branches, label of the target instruction - used only for parsing/debugging purposes
 } instruction_t; //data structure that defines the format of the instruction - when the parser passes the file, it passes it into another array of instructions
 
-class sim_pipe{
+//content of a vector register - a host SIMD vector, so that the element-wise operations compile to SIMD instructions
+typedef unsigned vreg_t __attribute__((vector_size(MAX_VL*sizeof(unsigned))));
+
+//returns the assembly text of the instruction, in the format accepted by load_program (without the label prefix)
+string instr_to_string(const instruction_t &instr);
+
+//returns the mnemonic of the opcode
+const char *opcode_name(opcode_t opcode);
+
+//a parsed program - it can be loaded in several simulators without being parsed again
+typedef struct{
+	vector<instruction_t> instructions; //including EOP
+	map<unsigned, string> labels; //labels, indexed by instruction number
+} program_t;
+
+//parses the assembly program in file "filename" (see sim_pipe_base::load_program);
+//returns false, with the reason in "error", if the file cannot be read or is not a valid program
+bool read_program(const char *filename, program_t &program, string &error);
+
+//data memory image: (address, value) pairs, each value is written with write_memory
+typedef vector<pair<unsigned, unsigned> > memory_image_t;
+
+//reads the data memory image in file "filename" (see sim_pipe_base::load_memory for the format);
+//returns false, with the reason in "error", if the file cannot be read
+bool read_memory_image(const char *filename, memory_image_t &image, string &error);
+
+/*
+Observer events - passed to the observer policy of sim_pipe_core (see below)
+*/
+
+typedef struct{
+	unsigned cycle; //clock cycle of the write-back
+	unsigned pc; //address of the instruction
+	const instruction_t *instr; //the instruction retired
+	unsigned result; //value written to the destination register (UNDEFINED if none or when replaying a trace)
+	unsigned address; //data address of memory instructions (vector: base address), target of branches (UNDEFINED otherwise)
+	bool taken; //true for taken branches
+	unsigned stored; //value stored by a SW to the device region (UNDEFINED otherwise)
+} retire_event_t;
+
+typedef struct{
+	unsigned cycle; //clock cycle of the access
+	unsigned pc; //address of the LW/SW instruction
+	unsigned address; //data memory address
+	unsigned value; //value loaded or stored
+	bool is_store; //true for SW, false for LW
+} memory_event_t;
+
+typedef struct{
+	unsigned cycle; //clock cycle in which the bubble is inserted
+	unsigned pc; //address of the stalled instruction
+	stall_cause_t cause; //reason of the stall
+} stall_event_t;
+
+typedef struct{
+	unsigned cycle; //clock cycle in which the branch is resolved
+	unsigned pc; //address of the taken branch
+	unsigned target; //address fetch is redirected to
+	unsigned slots; //number of wrong-path pipeline slots squashed
+} flush_event_t;
+
+typedef struct{
+	unsigned cycle; //clock cycle that ends
+	unsigned latches; //number of pipeline registers (pipeline depth - 1)
+	const unsigned *latch_data; //content of the pipeline registers at the end of the cycle, LATCH_WORDS words each
+	const instruction_t *latch_ir; //instruction held by each pipeline register
+	bool fetch; //IF read the instruction memory
+	unsigned reg_reads; //register operands read by ID (general purpose or vector)
+	opcode_t alu_op; //operation executed by EX (NOP if none)
+	unsigned alu_elements; //elements it operated on (1, or the vector length)
+} cycle_event_t;
+
+/*
+Observer policy that ignores every event. sim_pipe uses it, so the calls compile away.
+
+User policies are passed to sim_pipe_core as a template parameter and receive the events above.
+on_cycle is called at the end of every clock cycle, after the other events of the cycle.
+They can derive from null_observer and redefine only the events they are interested in, e.g.:
+
+	struct retire_counter : public null_observer {
+		unsigned count;
+		retire_counter() : count(0) {}
+		void on_retire(const retire_event_t &e){ count++; }
+	};
+
+	sim_pipe_core<retire_counter> *mips = new sim_pipe_core<retire_counter>(1024*1024, 0);
+	...
+	mips->get_observer().count;
+
+Code that instantiates sim_pipe_core with its own policy has to include "sim_pipe_core.h".
+*/
+struct null_observer{
+	inline void on_retire(const retire_event_t &e){}
+	inline void on_memory(const memory_event_t &e){}
+	inline void on_stall(const stall_event_t &e){}
+	inline void on_flush(const flush_event_t &e){}
+	inline void on_cycle(const cycle_event_t &e){}
+};
+
+/*
+Observer policy that records the trace of a run (see sim_trace.h), to be replayed by a configuration
+with_replay<...> (see below):
+
+	sim_pipe_core<trace_observer> *mips = ...;
+	mips->get_observer().writer.open("program.trace");
+	mips->run();
+	mips->get_observer().writer.close();
+
+Only single-thread runs can be recorded.
+*/
+struct trace_observer : public null_observer{
+	trace_writer writer;
+	inline void on_retire(const retire_event_t &e){
+		if (!writer.is_open()) return;
+		writer.add(e.pc | (e.taken ? TRACE_TAKEN : 0) | (e.stored != UNDEFINED ? TRACE_VALUE : 0), (e.address != UNDEFINED) ? e.address : 0);
+		if (e.stored != UNDEFINED) writer.add(0, e.stored);
+	}
+};
+
+/*
+Pipeline configurations - selected at compile time as a template parameter of sim_pipe_core.
+
+Each functional stage can be split in several sub-stages:
+- IF: the instruction memory is read in the first sub-stage
+- ID: registers are read and hazards are checked in the last sub-stage
+- EX: the ALU operates in the first sub-stage, the result is available at the end of the last one
+- MEM: the data memory is accessed in the first sub-stage, loaded values are available at the end of the last one
+Without forwarding, an instruction waits in ID until its producers have been written back.
+With forwarding, it waits until the producer's result has reached EX/MEM (ALU) or MEM/WB (LW).
+Taken branches are resolved in MEM and squash every younger instruction of their thread.
+With several hardware threads, every pipeline register carries the thread of its instruction:
+hazards and forwarding only involve instructions of the same thread, and a stalled instruction
+holds the stages before it whatever their thread (the threads hide each other's latencies
+by filling the slots between dependent instructions).
+A data memory access holds MEM, and every stage before it, for the data memory latency
+and while the DMA engine (see sim_devices.h) or the prefetcher (see sim_prefetch.h) uses the
+memory port; a load whose block the prefetcher has fetched does not use the port.
+*/
+struct classic_pipeline{ // IF ID EX MEM WB
+	static constexpr unsigned if_stages = 1;
+	static constexpr unsigned id_stages = 1;
+	static constexpr unsigned ex_stages = 1;
+	static constexpr unsigned mem_stages = 1;
+	static constexpr bool forwarding = false;
+	static constexpr bool replay = false;
+};
+
+struct pipeline_7 : public classic_pipeline{ // IF1 IF2 ID EX1 EX2 MEM WB
+	static constexpr unsigned if_stages = 2;
+	static constexpr unsigned ex_stages = 2;
+};
+
+struct pipeline_8 : public classic_pipeline{ // IF1 IF2 ID EX1 EX2 MEM1 MEM2 WB
+	static constexpr unsigned if_stages = 2;
+	static constexpr unsigned ex_stages = 2;
+	static constexpr unsigned mem_stages = 2;
+};
+
+// adds a forwarding network to a configuration, e.g. with_forwarding<pipeline_8>
+template <class Config>
+struct with_forwarding : public Config{
+	static constexpr bool forwarding = true;
+};
+
+// replays a trace (see sim_pipe_core::replay_trace) on a configuration, e.g. with_replay<pipeline_8>
+template <class Config>
+struct with_replay : public Config{
+	static constexpr bool replay = true;
+};
+
+/*
+State of the simulator and the functions that are not executed every clock cycle.
+The pipeline itself (run() and the stage functions) is in sim_pipe_core.
+*/
+class sim_pipe_base{
+
+protected:
 
         //instruction memory - models the part of the memory that contains the instruction
-		//an array of intruction_t data type
-        instruction_t instr_memory[PROGRAM_SIZE];
+		//an array of intruction_t data type (PROGRAM_SIZE entries)
+        instruction_t *instr_memory;
 
         //base address in the instruction memory where the program is loaded
         unsigned instr_base_address;
 
+	//number of instructions loaded (including EOP)
+	unsigned program_size;
+
+	//instruction memory entries (and profile slots) written since the last reset
+	unsigned dirty_size;
+
+	//labels of the loaded program, indexed by instruction number
+	map<unsigned, string> instr_labels;
+
 	//data memory - should be initialize to all 0xFF
 	unsigned char *data_memory;
 
@@ -60,19 +278,88 @@ class sim_pipe{
 	//memory latency in clock cycles
 	unsigned data_memory_latency; // there will be some data structure modeling data memory latency
 
+	//memory port shared by the MEM stage and the DMA engine: first cycle it is free
+	unsigned port_free;
+
+	//cycle the access of the instruction in MEM completes (UNDEFINED if not started)
+	unsigned mem_done;
+
+	//true while MEM waits for the memory port (the stages before it hold)
+	bool mem_stall;
+
+	//vector unit: vector length, lanes (elements processed per cycle) and pipeline latency in clock cycles
+	unsigned vector_length;
+	unsigned vector_lanes;
+	unsigned vector_latency;
+
+	//all-ones in the first vector_length elements, zero in the others
+	vreg_t vector_mask;
+
+	//cycle the vector operation in EX completes (UNDEFINED if not started)
+	unsigned vector_done;
+
+	//true while EX waits for the vector unit (the stages before it hold)
+	bool ex_stall;
+
+	//results of the vector instructions in flight: the pipeline registers hold the index of the entry
+	//(in lmd for vector loads, in alu_out for the others, in b for the data of vector stores)
+	vreg_t vresults[MAX_STAGES];
+	unsigned next_vresult;
+
+	//base address of the device region (UNDEFINED if no devices are mapped)
+	unsigned io_base;
+
+	//memory-mapped devices
+	sim_devices devices;
+
+	//data prefetcher
+	sim_prefetcher prefetcher;
+
+	//data address outside data memory that stopped the run, and address of the instruction that accessed it
+	//(UNDEFINED if none)
+	unsigned memory_fault;
+	unsigned memory_fault_pc;
+
 	//statistics
 	unsigned clock_cycles;
 	unsigned stalls;
 	unsigned instructions_executed;
 
+	//per-PC profile (retired instructions, stalls by cause, flushed slots)
+	sim_profile profile;
+
 	/* registers */
-    
-	unsigned regs[NUM_REGS];
 
-	unsigned ProgramCount;
+	//hardware thread context: each thread has its own registers, program counter and program
+	//(thread 0 runs the program loaded with load_program, the others the ones added with add_thread)
+	struct ThreadContext {
+		unsigned regs[NUM_REGS];
+		vreg_t vregs[NUM_VREGS];
+		unsigned ProgramCount;
+		unsigned start; //address of the first instruction of its program
+		bool fetched_eop; //IF has fetched its EOP: it is not fetched from again, unless a branch redirects it
+		bool finished; //its EOP has reached WB
+		unsigned finish_cycle;
+		unsigned instructions_executed;
+		unsigned stalls; //stall cycles charged to its instructions
+		unsigned switches; //thread switches caused by its stalls (SWITCH_ON_STALL)
+	};
+
+	ThreadContext threads[MAX_THREADS];
+
+	//number of threads, and threads whose EOP has not reached WB yet
+	unsigned num_threads;
+	unsigned threads_running;
+
+	//fetch policy, and the thread it considers first
+	fetch_policy_t fetch_policy;
+	unsigned fetch_thread;
 
 	bool is_stall;
 
+	//cause of the stall currently in progress
+	stall_cause_t stall_cause;
+
 	struct PipelineStage {
 		
 		unsigned pc;
@@ -83,28 +370,189 @@ class sim_pipe{
 		unsigned lmd;
 		unsigned alu_out;
 		unsigned cond;
+		unsigned thread; //hardware thread of the instruction
 
 	};
+	static_assert(sizeof(PipelineStage) == LATCH_WORDS*sizeof(unsigned), "LATCH_WORDS does not match PipelineStage");
 
-	PipelineStage pipelineRegisters[NUM_STAGES-1];
+	// pipeline registers - in deeper configurations a functional stage is split into
+	// sub-stages, with one pipeline register between consecutive sub-stages
+	PipelineStage pipelineRegisters[MAX_STAGES-1];
 
 	// IR is stored using the instruction_t data type
-	instruction_t ir[NUM_STAGES-1];
+	instruction_t ir[MAX_STAGES-1];
+
+	// index in pipelineRegisters/ir of the IF/ID, ID/EX, EX/MEM and MEM/WB registers
+	unsigned latch_of[NUM_STAGES-1];
+
+	//set by ID when it takes the instruction out of its input register, so that the front-end can advance
+	bool frontend_advance;
+
+	//state of the simulator at the beginning of clock cycle "cycle" - the data memory is saved as the
+	//pages written since the previous snapshot (the first snapshot holds every page)
+	struct Snapshot {
+		unsigned cycle;
+		unsigned stalls;
+		unsigned instructions_executed;
+		ThreadContext threads[MAX_THREADS];
+		unsigned threads_running;
+		unsigned fetch_thread;
+		bool is_stall;
+		stall_cause_t stall_cause;
+		bool frontend_advance;
+		unsigned port_free;
+		unsigned mem_done;
+		bool mem_stall;
+		unsigned vector_done;
+		bool ex_stall;
+		vreg_t vresults[MAX_STAGES];
+		unsigned next_vresult;
+		PipelineStage pipelineRegisters[MAX_STAGES-1];
+		instruction_t ir[MAX_STAGES-1];
+		sim_devices devices;
+		sim_prefetcher prefetcher;
+		vector<unsigned> replay; //state of the trace replay (see replay_state), saved by sim_pipe_core
+		vector<unsigned> profile;
+		vector<unsigned> pages; //page numbers, in increasing order
+		vector<unsigned char> page_data; //SNAPSHOT_PAGE bytes per page
+	};
+
+	//snapshots, in increasing cycle order
+	vector<Snapshot> snapshots;
+
+	//cycles between snapshots (0 if disabled) and cycle of the next one (UNDEFINED if disabled)
+	unsigned snapshot_interval;
+	unsigned next_snapshot;
+
+	//memory budget of the snapshots and memory they use (in bytes)
+	unsigned long long snapshot_budget;
+	unsigned long long snapshot_memory;
+
+	//data memory pages written since the last snapshot (empty if the snapshots are disabled)
+	vector<bool> page_dirty;
+
+	//data memory pages written since the last reset (SNAPSHOT_PAGE bytes each), which reset fills with 0xFF again
+	vector<bool> page_written;
+
+	//takes a snapshot of the current state (at the beginning of a clock cycle)
+	void take_snapshot();
+
+	//restores snapshot "idx" and discards the ones after it
+	void restore_snapshot(unsigned idx);
+
+	//returns the index of the last snapshot taken at or before "cycle" (UNDEFINED if none)
+	unsigned find_snapshot(unsigned cycle);
+
+	//adds the pages the DMA engine may have written to page_dirty and page_written
+	void mark_dma_pages();
+
+	//drops every other snapshot (the first and the last are kept) and doubles the interval
+	void thin_snapshots();
+
+	//returns the memory used by a snapshot (in bytes)
+	unsigned long long snapshot_bytes(Snapshot &s);
+
+	//returns the static instruction number of the instruction at address "pc"
+	inline unsigned instr_index(unsigned pc){ return (pc - instr_base_address) >> 2; }
+
+	//returns true if "address" belongs to the device region
+	inline bool is_io(unsigned address){ return io_base != UNDEFINED && address - io_base < IO_SIZE; }
+
+	//returns true if the word at "address" is in data memory
+	inline bool in_data_memory(unsigned address){ return address < data_memory_size && data_memory_size - address >= 4; }
+
+	//returns true if the elements of a vector access at "address" ("stride" bytes apart) are in data memory
+	inline bool vector_in_data_memory(unsigned address, unsigned stride){
+		for (unsigned i=0; i<vector_length; i++)
+			if (!in_data_memory(address + i*stride)) return false;
+		return true;
+	}
+
+	//returns the result cache key of the job: program, initial state and configuration ("config" hashes the pipeline configuration)
+	//the initial state is the registers of thread 0 and the content of the data memory pages written since the reset,
+	//whatever the order they were written in
+	unsigned long long job_key(unsigned long long config);
+
+	//fills "result" with the final state: statistics, registers of thread 0, pipeline registers and IR, thread context,
+	//profile, console and data memory; returns false if the run wrote more than CACHE_MAX_PAGES pages or stopped on
+	//a memory fault
+	bool save_result(sim_result_t &result);
+
+	//restores the final state from "result"; returns false (nothing is restored) if it does not fit the simulator
+	bool restore_result(const sim_result_t &result);
+
+	//returns true while the vector operation in EX has not completed (the vector unit is started the first time it is called for the instruction)
+	inline bool vector_wait(){
+		if (vector_done == UNDEFINED) vector_done = clock_cycles + (vector_length + vector_lanes - 1) / vector_lanes + vector_latency - 2;
+		if (clock_cycles < vector_done) return true;
+		vector_done = UNDEFINED;
+		return false;
+	}
+
+	//returns true while the data memory access of the instruction in MEM waits for the memory port
+	//(the port is reserved the first time it is called for the instruction, for "accesses" consecutive accesses)
+	inline bool port_wait(unsigned accesses=1){
+		if (mem_done == UNDEFINED){
+			mem_done = (port_free > clock_cycles ? port_free : clock_cycles) + accesses*(data_memory_latency+1) - 1;
+			port_free = mem_done + 1;
+		}
+		if (clock_cycles < mem_done) return true;
+		mem_done = UNDEFINED;
+		return false;
+	}
+
+	//same as port_wait for the load of "address" by the instruction at "pc" when a prefetcher is selected:
+	//the load waits for its block instead if the prefetcher has fetched it
+	inline bool load_wait(unsigned pc, unsigned address){
+		if (mem_done == UNDEFINED){
+			unsigned ready = prefetcher.load(pc, address, clock_cycles);
+			if (ready == UNDEFINED) return port_wait();
+			mem_done = (ready > clock_cycles) ? ready : clock_cycles;
+		}
+		if (clock_cycles < mem_done) return true;
+		mem_done = UNDEFINED;
+		return false;
+	}
 
 public:
 
 	//instantiates the simulator with a data memory of given size (in bytes) and latency (in clock cycles)
-	sim_pipe(unsigned data_mem_size, unsigned data_mem_latency);
+	sim_pipe_base(unsigned data_mem_size, unsigned data_mem_latency);
 	
 	//de-allocates the simulator
-	~sim_pipe();
+	~sim_pipe_base();
 
 	//loads the assembly program in file "filename" in instruction memory at the specified address
 	void load_program(const char *filename, unsigned base_address=0x0);
 
-	//runs the simulator for "cycles" clock cycles (run the program to completion if cycles=0) 
-	void run(unsigned cycles=0);
-	
+	//loads a program parsed before (see get_program) in instruction memory at the specified address
+	void load_program(const program_t &program, unsigned base_address=0x0);
+
+	//adds a hardware thread that runs the program in file "filename" (or parsed before), and returns its number
+	//the program is placed in instruction memory after the ones loaded before (load_program leaves one thread);
+	//the threads share the data memory and the pipeline, IF interleaves them according to the fetch policy
+	unsigned add_thread(const char *filename);
+
+	unsigned add_thread(const program_t &program);
+
+	//sets the fetch policy (ROUND_ROBIN by default)
+	void set_fetch_policy(fetch_policy_t policy);
+
+	//returns the number of hardware threads
+	unsigned get_thread_count();
+
+	//returns the loaded program
+	void get_program(program_t &program);
+
+	//keeps a snapshot of the state every "interval" clock cycles (0 disables them), within "budget" bytes
+	//(when the budget is exceeded every other snapshot is dropped and the interval doubles), see seek
+	void set_snapshots(unsigned interval, unsigned long long budget=SNAPSHOT_BUDGET);
+
+	//returns the number of snapshots kept and the memory they use (in bytes)
+	unsigned get_snapshot_count();
+
+	unsigned long long get_snapshot_memory();
+
 	//resets the state of the simulator
         /* Note: 
 	   - registers should be reset to UNDEFINED value 
@@ -131,6 +579,22 @@ public:
 	// set the value of the given general purpose register to "value"
 	void set_gp_register(unsigned reg, int value);
 
+	//same, for the registers of hardware thread "thread" (the functions above access thread 0)
+	int get_gp_register(unsigned thread, unsigned reg);
+
+	void set_gp_register(unsigned thread, unsigned reg, int value);
+
+	//returns element "element" of vector register "reg"
+	unsigned get_vector_register(unsigned reg, unsigned element);
+
+	//sets element "element" of vector register "reg" to "value"
+	void set_vector_register(unsigned reg, unsigned element, unsigned value);
+
+	//configures the vector unit: vector length (1 to MAX_VL elements), lanes and latency (in clock cycles)
+	//a vector arithmetic instruction or reduction holds EX for ceil(length/lanes) + latency - 1 cycles;
+	//a vector memory instruction makes ceil(length/lanes) accesses to the memory port (length accesses if strided)
+	void set_vector_unit(unsigned length, unsigned lanes, unsigned latency);
+
 	//returns the IPC
 	float get_IPC();
 
@@ -143,15 +607,242 @@ public:
 	//returns the number of stalls added by processor
 	unsigned get_stalls();
 
+	//per-thread statistics: instructions executed, stall cycles charged to its instructions, thread switches
+	//caused by its stalls, and clock cycle its EOP reached WB (UNDEFINED while it runs)
+	unsigned get_instructions_executed(unsigned thread);
+
+	unsigned get_stalls(unsigned thread);
+
+	unsigned get_thread_switches(unsigned thread);
+
+	unsigned get_finish_cycle(unsigned thread);
+
+	//returns the data address outside data memory that stopped the run (UNDEFINED if none) and the address of the
+	//instruction that accessed it: the run stops when the instruction reaches MEM, and run() does nothing until reset
+	unsigned get_memory_fault();
+
+	unsigned get_memory_fault_pc();
+
+	//prints the per-thread statistics
+	void print_thread_statistics();
+
 	//prints the content of the data memory within the specified address range
 	void print_memory(unsigned start_address, unsigned end_address);
 
 	// writes an integer value to data memory at the specified address (use little-endian format: https://en.wikipedia.org/wiki/Endianness)
 	void write_memory(unsigned address, unsigned value);
 
+	// loads a data memory image: one "<address> <value>" pair per line (decimal or 0x-prefixed hex),
+	// each value is written with write_memory; lines starting with '#' are ignored
+	void load_memory(const char *filename);
+
+	// loads a data memory image read before with read_memory_image
+	void load_memory(const memory_image_t &image);
+
 	//prints the values of the registers 
 	void print_registers();
 
+	//prints the per-PC profile of the program: annotated listing, basic block and label summaries
+	void print_profile();
+
+	//writes the per-PC profile in folded-stack format (input of flamegraph.pl and compatible tools)
+	void write_folded_profile(const char *filename);
+
+	//returns the profile collected so far
+	sim_profile &get_profile();
+
+	//maps the device registers (see sim_devices.h) at "base_address" - UNDEFINED unmaps them
+	//the region shadows the data memory it overlaps
+	void set_io_base(unsigned base_address);
+
+	//returns the memory-mapped devices
+	sim_devices &get_devices();
+
+	//selects the data prefetcher (PREFETCH_NONE disables it) and its parameters (see sim_prefetch.h)
+	void set_prefetcher(prefetch_kind_t prefetcher, unsigned degree=1, unsigned distance=1, unsigned queue_size=8,
+		unsigned buffer_size=16, unsigned block=16);
+
+	//returns the data prefetcher (configuration and statistics)
+	sim_prefetcher &get_prefetcher();
+
+	//returns the number of instructions of the loaded program (including EOP)
+	unsigned get_program_size();
+
+	//returns the instruction number "idx" of the loaded program
+	const instruction_t &get_instruction(unsigned idx);
+
+	//returns the labels of the loaded program, indexed by instruction number
+	map<unsigned, string> &get_labels();
+
+	//fills the assembly text and the basic block leader flags of the loaded program
+	void annotate_program(string *text, bool *leader);
+
+	//returns the digest of the data memory
+	unsigned long long get_memory_digest();
+
+};
+
+/*
+State of the trace replay: a base of sim_pipe_core for the configurations with_replay<...>,
+empty for the others (their pipeline registers and their state carry none of it).
+*/
+template <bool Replay>
+class replay_state{};
+
+template <>
+class replay_state<true>{
+
+protected:
+
+	//trace replayed instead of executing the program
+	trace_reader trace;
+
+	//next record IF takes, and true while IF fetches the wrong path of a taken branch
+	//(the instructions it fetches then take no record)
+	unsigned trace_next;
+	bool trace_wrong_path;
+
+	//trace record of the instruction in each pipeline register (UNDEFINED on the wrong path)
+	unsigned trace_record[MAX_STAGES-1];
+
+	//goes back to the first record
+	inline void rewind(){
+		trace_next = 0;
+		trace_wrong_path = false;
+		for (unsigned i=0; i<MAX_STAGES-1; i++) trace_record[i] = UNDEFINED;
+	}
+
+	//saves the state in "state" (see sim_pipe_base::Snapshot), and restores it
+	inline void save(vector<unsigned> &state){
+		state.assign(trace_record, trace_record + MAX_STAGES-1);
+		state.push_back(trace_next);
+		state.push_back(trace_wrong_path);
+	}
+
+	inline void restore(const vector<unsigned> &state){
+		for (unsigned i=0; i<MAX_STAGES-1; i++) trace_record[i] = state[i];
+		trace_next = state[MAX_STAGES-1];
+		trace_wrong_path = state[MAX_STAGES];
+	}
+
+public:
+
+	replay_state(){ rewind(); }
+
+	//replays the trace in file "filename" (see sim_trace.h) instead of executing the program, which must be
+	//loaded at the address it was recorded at: IF follows the recorded path, the branch outcomes and the data
+	//addresses come from the trace, and no register or data memory word is read or written (the stores to the
+	//device region excepted), so only the timing and the statistics are meaningful. Single thread only; a
+	//program whose path depends on the timing (e.g. polling a device) follows the recorded path.
+	inline void replay_trace(const char *filename){
+		trace.open(filename);
+		rewind();
+	}
+};
+
+/*
+Pipeline of the simulator, parameterized by the observer policy (see null_observer above)
+and by the pipeline configuration (see classic_pipeline above).
+*/
+template <class Observer, class Config = classic_pipeline>
+class sim_pipe_core : public sim_pipe_base, public replay_state<Config::replay>{
+
+	//receives the retire, memory, stall and flush events
+	Observer observer;
+
+	//false for null_observer: the event calls are discarded at compile time
+	static constexpr bool observed = !is_same<Observer, null_observer>::value;
+
+public:
+
+	//number of pipeline stages
+	static constexpr unsigned DEPTH = Config::if_stages + Config::id_stages + Config::ex_stages + Config::mem_stages + 1;
+
+	//position of the pipeline registers at the boundary of the functional stages
+	static constexpr unsigned L_IF_ID = Config::if_stages - 1;
+	static constexpr unsigned L_ID_EXE = L_IF_ID + Config::id_stages;
+	static constexpr unsigned L_EXE_MEM = L_ID_EXE + Config::ex_stages;
+	static constexpr unsigned L_MEM_WB = L_EXE_MEM + Config::mem_stages;
+
+	//slots squashed by a taken branch (every pipeline register before EX/MEM)
+	static constexpr unsigned FLUSH_SLOTS = L_EXE_MEM;
+
+	static_assert(Config::if_stages >= 1 && Config::id_stages >= 1 && Config::ex_stages >= 1 && Config::mem_stages >= 1, "every functional stage needs at least one sub-stage");
+	static_assert(DEPTH <= MAX_STAGES, "pipeline deeper than MAX_STAGES");
+
+private:
+
+	//activity of the current cycle, for the on_cycle event (only updated if the policy is not null_observer)
+	bool cycle_fetch;
+	unsigned cycle_reg_reads;
+	opcode_t cycle_alu_op;
+	unsigned cycle_alu_elements;
+
+	//reads the source operands of the instruction in ID/EX from the register file
+	void read_operands();
+
+	//returns true if the instruction in ID/EX has to wait for a producer, and the cause of the stall
+	bool raw_hazard(stall_cause_t &cause);
+
+	//returns the value of register "reg" for the instruction entering EX (forwarding configurations)
+	unsigned forward_operand(unsigned reg);
+
+	//returns the value of vector register "reg" for the instruction in EX
+	const vreg_t &vector_operand(unsigned reg);
+
+	//vector parts of EX and MEM
+	void vector_execute();
+
+	void vector_memory();
+
+	//moves the content of the pipeline register before sub-stage "S" to the one after it
+	template <unsigned S> inline void pass_stage();
+
+	//runs the pass-through sub-stages FROM, FROM-1, ..., TO (in this order)
+	template <unsigned FROM, unsigned TO> inline void pass_stages();
+
+	//same as pass_stages, for the sub-stages before ID (they hold while ID is stalled)
+	template <unsigned FROM, unsigned TO> inline void frontend_stages();
+
+	//returns the thread IF fetches from in this cycle according to the fetch policy (UNDEFINED if none)
+	unsigned select_thread();
+
+	//squashes the instructions of thread "thread" in the pipeline registers 0 to "last"
+	void squash_thread(unsigned thread, unsigned last);
+
+	//SWITCH_ON_STALL: squashes the thread of the instruction stalled in ID, from that instruction on,
+	//and makes IF fetch from the next thread; returns false if no other thread can be fetched from
+	bool switch_thread();
+
+public:
+
+	//instantiates the simulator with a data memory of given size (in bytes) and latency (in clock cycles)
+	sim_pipe_core(unsigned data_mem_size, unsigned data_mem_latency);
+
+	//runs the simulator for "cycles" clock cycles (run the program to completion if cycles=0) 
+	void run(unsigned cycles=0);
+
+	//runs the program to completion, unless the same job (program, state set before the run,
+	//configuration and simulator executable) is in "cache": then the final state is restored from it -
+	//statistics, general purpose and vector registers, pipeline registers, profile, data memory and
+	//console output - and the observer gets no event. Runs with several hardware threads or with a
+	//prefetcher (its statistics are not stored), and runs writing more than CACHE_MAX_PAGES pages, are
+	//not cached. Returns true on a cache hit
+	bool run(sim_cache &cache);
+
+	//brings the simulator to the beginning of clock cycle "cycle" (i.e. get_clock_cycles() == cycle):
+	//the last snapshot taken at or before it is restored and the remaining cycles are simulated again
+	//(the observer receives their events again; writes done with write_memory/set_gp_register after
+	//the snapshot are lost). Returns false if "cycle" is before the first snapshot (the state is not
+	//changed) or after the end of the program (the simulator stops at the end of the program)
+	bool seek(unsigned cycle);
+
+	//goes back one clock cycle (see seek)
+	bool step_back();
+
+	//returns the observer policy instance
+	Observer &get_observer();
+
 	void instruction_fetch();
 
 	void instruction_decode();
@@ -166,4 +857,9 @@ public:
 
 };
 
+// the simulator without observer is compiled once, in sim_pipe.cc
+extern template class sim_pipe_core<null_observer, classic_pipeline>;
+
+typedef sim_pipe_core<null_observer> sim_pipe;
+
 #endif /*SIM_PIPE_H_*/
@@ -0,0 +1,901 @@
+#ifndef SIM_PIPE_CORE_H_
+#define SIM_PIPE_CORE_H_
+
+#include "sim_pipe.h"
+#include <cstring>
+#include <iostream>
+#include <stdlib.h>
+
+using namespace std;
+
+/* =============================================================
+
+   HELPER FUNCTIONS
+
+   ============================================================= */
+
+
+/* converts integer into array of unsigned char - little indian */
+inline void int2char(unsigned value, unsigned char *buffer){
+	memcpy(buffer, &value, sizeof value);
+}
+
+/* converts array of char into integer - little indian */
+inline unsigned char2int(unsigned char *buffer){
+	unsigned d;
+	memcpy(&d, buffer, sizeof d);
+	return d;
+}
+
+/* implements the ALU operations */
+inline unsigned alu(opcode_t opcode, unsigned a, unsigned b, unsigned imm, unsigned npc){
+	switch(opcode){
+			case ADD:
+				return (a+b);
+			case ADDI:
+				return(a+imm);
+			case SUB:
+				return(a-b);
+			case SUBI:
+				return(a-imm);
+			case XOR:
+				return(a ^ b);
+			case LW:
+			case SW:
+			case VLW:
+			case VSW:
+				return(a + imm);
+			case VLWS:
+			case VSWS:
+				return(a);
+			case BEQZ:
+			case BNEZ:
+			case BGTZ:
+			case BGEZ:
+			case BLTZ:
+			case BLEZ:
+			case JUMP:
+				return(npc+imm);
+			default:	
+				return (-1);
+	}
+}
+
+/* returns true if the instruction is a taken branch/jump */
+inline bool taken_branch(opcode_t opcode, unsigned a){
+        switch(opcode){
+                case BEQZ:
+                        if (a==0) return true;
+                        break;
+                case BNEZ:
+                        if (a!=0) return true;
+                        break;
+                case BGTZ:
+                        if ((int)a>0)  return true;
+                        break;
+                case BGEZ:
+                        if ((int)a>=0) return true;
+                        break;
+                case BLTZ:
+                        if ((int)a<0)  return true;
+                        break;
+                case BLEZ:
+                        if ((int)a<=0) return true;
+                        break;
+                case JUMP:
+                        return true;
+                default:
+                        return false;
+        }
+        return false;
+}
+
+/* return the kind of instruction encoded */ 
+
+inline bool is_branch(opcode_t opcode){
+        return (opcode == BEQZ || opcode == BNEZ || opcode == BLTZ || opcode == BLEZ || opcode == BGTZ || opcode == BGEZ || opcode == JUMP);
+}
+
+inline bool is_memory(opcode_t opcode){
+        return (opcode == LW || opcode == SW);
+}
+
+inline bool is_int_r(opcode_t opcode){
+        return (opcode == ADD || opcode == SUB || opcode == XOR);
+}
+
+inline bool is_int_imm(opcode_t opcode){
+        return (opcode == ADDI || opcode == SUBI);
+}
+
+inline bool is_vector(opcode_t opcode){
+        return (opcode >= VLW && opcode <= VREDXOR);
+}
+
+inline bool is_vector_memory(opcode_t opcode){
+        return (opcode == VLW || opcode == VSW || opcode == VLWS || opcode == VSWS);
+}
+
+/* returns true if the instruction executes in the vector unit (element-wise operations and reductions) */
+inline bool is_vector_unit(opcode_t opcode){
+        return (is_vector(opcode) && !is_vector_memory(opcode));
+}
+
+/* returns true if the result of the instruction comes from the data memory */
+inline bool is_load(opcode_t opcode){
+        return (opcode == LW || opcode == VLW || opcode == VLWS);
+}
+
+/* returns true if the instruction writes a vector register */
+inline bool writes_vector(opcode_t opcode){
+        return (opcode == VLW || opcode == VLWS || opcode == VADD || opcode == VSUB || opcode == VXOR || opcode == VMUL);
+}
+
+/* returns true if the instruction writes a general purpose or a vector register */
+inline bool writes_register(opcode_t opcode){
+        return (opcode == LW || is_int_r(opcode) || is_int_imm(opcode) || writes_vector(opcode) || opcode == VREDSUM || opcode == VREDXOR);
+}
+
+/* returns true if the instruction reads src1 / src2 (general purpose or vector register) */
+inline bool reads_src1(opcode_t opcode){
+        return (is_memory(opcode) || is_int_r(opcode) || is_int_imm(opcode) || (is_branch(opcode) && opcode != JUMP) || is_vector(opcode));
+}
+
+inline bool reads_src2(opcode_t opcode){
+        return (opcode == SW || is_int_r(opcode) || opcode == VSW || opcode == VSWS || (is_vector_unit(opcode) && opcode != VREDSUM && opcode != VREDXOR));
+}
+
+
+/* =============================================================
+
+   PIPELINE
+
+   ============================================================= */
+
+/* initializes the pipeline simulator */
+template <class Observer, class Config>
+sim_pipe_core<Observer, Config>::sim_pipe_core(unsigned mem_size, unsigned mem_latency) : sim_pipe_base(mem_size, mem_latency){
+	latch_of[IF_ID] = L_IF_ID;
+	latch_of[ID_EXE] = L_ID_EXE;
+	latch_of[EXE_MEM] = L_EXE_MEM;
+	latch_of[MEM_WB] = L_MEM_WB;
+	cycle_fetch = false;
+	cycle_reg_reads = 0;
+	cycle_alu_op = NOP;
+	cycle_alu_elements = 0;
+}
+
+/* returns the observer policy instance */
+template <class Observer, class Config>
+Observer &sim_pipe_core<Observer, Config>::get_observer(){return observer;}
+
+/* moves the content of the pipeline register before sub-stage S to the one after it */
+template <class Observer, class Config>
+template <unsigned S>
+inline void sim_pipe_core<Observer, Config>::pass_stage(){
+	ir[S] = ir[S-1];
+	pipelineRegisters[S] = pipelineRegisters[S-1];
+	if constexpr (Config::replay) this->trace_record[S] = this->trace_record[S-1];
+}
+
+/* pass-through sub-stages FROM down to TO - unrolled at compile time */
+template <class Observer, class Config>
+template <unsigned FROM, unsigned TO>
+inline void sim_pipe_core<Observer, Config>::pass_stages(){
+	if constexpr (FROM >= TO){
+		pass_stage<FROM>();
+		if constexpr (FROM > TO) pass_stages<FROM-1, TO>();
+	}
+}
+
+/* pass-through sub-stages before ID: they only advance when the next sub-stage took their instruction */
+template <class Observer, class Config>
+template <unsigned FROM, unsigned TO>
+inline void sim_pipe_core<Observer, Config>::frontend_stages(){
+	if constexpr (FROM >= TO){
+		if (frontend_advance) pass_stage<FROM>();
+		if constexpr (FROM > TO) frontend_stages<FROM-1, TO>();
+	}
+}
+
+/* <TODO: BODY OF THE SIMULATOR */
+// Note: processing the stages in reverse order simplifies the data propagation through pipeline registers
+template <class Observer, class Config>
+void sim_pipe_core<Observer, Config>::run(unsigned cycles){
+
+	unsigned start_cycles = clock_cycles;
+
+	/* initialization at the beginning of simulation */
+	if (clock_cycles == 0){
+		if constexpr (Config::replay){
+			if (!this->trace.is_open() || num_threads > 1){
+				cerr << "error: a replay needs a trace (see replay_trace) and a single thread!" << endl;
+				exit(-1);
+			}
+			this->rewind();
+		}
+		for (unsigned t=0; t<num_threads; t++){
+			threads[t].ProgramCount = threads[t].start;
+			threads[t].fetched_eop = threads[t].finished = false;
+			threads[t].finish_cycle = UNDEFINED;
+		}
+		threads_running = num_threads;
+	}
+
+	/* ====== MAIN SIMULATION LOOP (one iteration per clock cycle)  ========= */
+	while(cycles==0 || clock_cycles-start_cycles!=cycles){
+
+		// an access outside data memory stopped the run (see get_memory_fault)
+		if (memory_fault != UNDEFINED) break;
+
+		if (clock_cycles == next_snapshot){
+			take_snapshot();
+			if constexpr (Config::replay) this->save(snapshots.back().replay);
+		}
+
+                /* =============== */
+                /* PIPELINE STAGES */
+                /* =============== */
+		/* ============   WB stage   ============  */
+			// <hint: the simulation loop should be exited when the instruction processed is EOP>
+		
+		if (ir[L_MEM_WB].opcode == EOP){
+			// the simulation ends with the EOP of the last thread (the ones of the other threads are not written back)
+			if (threads_running == 0) break;
+		} else write_back();
+
+		/* ============   MEM stage   ===========  */
+		pass_stages<L_MEM_WB, L_EXE_MEM+2>();
+		memory_stage();
+
+		// the stages before MEM hold while it waits for the memory port
+		if (!mem_stall){
+
+			/* ============   EXE stage   ===========  */
+			pass_stages<L_EXE_MEM, L_ID_EXE+2>();
+			execute_stage();
+
+			// and the ones before EX while it waits for the vector unit
+			if (!ex_stall){
+
+				/* ============   ID stage   ============  */
+				instruction_decode();
+				frontend_stages<L_ID_EXE-1, L_IF_ID+1>();
+
+				/* ============   IF stage   ============  */
+				frontend_stages<L_IF_ID, 1>();
+				instruction_fetch();
+			}
+		}
+
+		/* ============   devices   ============  */
+		// the timer and the cycle counter follow clock_cycles, the DMA engine uses the memory port when MEM leaves it free
+		if (devices.dma_active()) devices.dma_step(clock_cycles, port_free, data_memory_latency);
+
+		// the prefetches get the memory port last
+		if (prefetcher.active()) prefetcher.step(clock_cycles, port_free, data_memory_latency);
+
+		// a thread has completed when its EOP reaches WB (in the next cycle)
+		if (ir[L_MEM_WB].opcode == EOP){
+			ThreadContext &thread = threads[pipelineRegisters[L_MEM_WB].thread];
+			if (!thread.finished){
+				thread.finished = true;
+				thread.finish_cycle = clock_cycles + 1;
+				threads_running--;
+			}
+		}
+
+		if constexpr (observed){
+			observer.on_cycle(cycle_event_t{clock_cycles, DEPTH-1, &pipelineRegisters[0].pc, ir, cycle_fetch, cycle_reg_reads, cycle_alu_op, cycle_alu_elements});
+			cycle_fetch = false;
+			cycle_reg_reads = 0;
+			cycle_alu_op = NOP;
+			cycle_alu_elements = 0;
+		}
+
+                /* =============== */
+                /* END STAGES      */
+                /* =============== */
+
+		/* Other bookkeeping code */
+                /* ====================== */
+
+		clock_cycles++; // increase clock cycles count
+
+	}
+}
+
+/* runs the program to completion, or restores its final state from the result cache */
+template <class Observer, class Config>
+bool sim_pipe_core<Observer, Config>::run(sim_cache &cache){
+
+	// only complete runs from the initial state can be reused, and the result holds a single thread context
+	// (trace replays are not cached: the trace is not part of the key, neither are the prefetcher statistics)
+	if (Config::replay || clock_cycles != 0 || num_threads > 1 || prefetcher.enabled()){
+		run();
+		return false;
+	}
+
+	sim_hash config;
+	config.add(Config::if_stages);
+	config.add(Config::id_stages);
+	config.add(Config::ex_stages);
+	config.add(Config::mem_stages);
+	config.add(Config::forwarding);
+	unsigned long long key = job_key(config.get());
+
+	sim_result_t result;
+	if (cache.lookup(key, result) && restore_result(result)) return true;
+
+	run();
+	if (save_result(result)) cache.store(key, result);
+	return false;
+}
+
+/* restores the last snapshot before "cycle" and simulates the cycles left */
+template <class Observer, class Config>
+bool sim_pipe_core<Observer, Config>::seek(unsigned cycle){
+
+	// forward: the simulation simply goes on from the current state
+	if (cycle < clock_cycles){
+		unsigned idx = find_snapshot(cycle);
+		if (idx == UNDEFINED) return false;
+		restore_snapshot(idx);
+		if constexpr (Config::replay) this->restore(snapshots[idx].replay);
+	}
+	if (cycle > clock_cycles) run(cycle - clock_cycles);
+	return clock_cycles == cycle;
+}
+
+/* goes back one clock cycle */
+template <class Observer, class Config>
+bool sim_pipe_core<Observer, Config>::step_back(){
+	if (clock_cycles == 0) return false;
+	return seek(clock_cycles - 1);
+}
+
+/* thread IF fetches from: the first one, from fetch_thread on, that has not fetched its EOP (ICOUNT: the one with the fewest instructions in the pipeline) */
+template <class Observer, class Config>
+unsigned sim_pipe_core<Observer, Config>::select_thread() {
+
+	unsigned best = UNDEFINED, best_count = UNDEFINED;
+	for (unsigned k=0; k<num_threads; k++){
+		unsigned t = (fetch_thread + k) % num_threads;
+		if (threads[t].fetched_eop) continue;
+		if (fetch_policy != ICOUNT) return t;
+		unsigned count = 0;
+		for (unsigned l=0; l<=L_MEM_WB; l++) count += (ir[l].opcode != NOP && pipelineRegisters[l].thread == t);
+		if (count < best_count){
+			best = t;
+			best_count = count;
+		}
+	}
+	return best;
+}
+
+template <class Observer, class Config>
+void sim_pipe_core<Observer, Config>::instruction_fetch() {
+
+	// single fetch stage: IF/ID is refilled every cycle, PC only advances when ID is not stalled
+	// otherwise the first sub-stage only fetches when its pipeline register has moved on
+	constexpr bool refill = (Config::if_stages == 1 && Config::id_stages == 1);
+	if (!refill && !frontend_advance) return;
+	bool advance = !refill || !is_stall;
+
+	// hardware thread to fetch from: none once every thread has fetched its EOP
+	unsigned t = (num_threads == 1) ? 0 : select_thread();
+	if (t == UNDEFINED){
+		ir[0].opcode = NOP;
+		ir[0].src1 = UNDEFINED;
+		ir[0].src2 = UNDEFINED;
+		ir[0].dest = UNDEFINED;
+		ir[0].immediate = UNDEFINED;
+		pipelineRegisters[0].pc = UNDEFINED;
+		pipelineRegisters[0].npc = UNDEFINED;
+		return;
+	}
+	ThreadContext &thread = threads[t];
+
+	// Fetch the instruction from memory at the current program counter (PC)
+	ir[0] = instr_memory[(thread.ProgramCount-instr_base_address)>>2];
+	if constexpr (observed) cycle_fetch = true;
+
+	pipelineRegisters[0].pc = thread.ProgramCount;
+	pipelineRegisters[0].npc = thread.ProgramCount;
+	pipelineRegisters[0].thread = t;
+
+	// trace replay: the instructions of the recorded path take the next record, in order
+	if constexpr (Config::replay){
+		this->trace_record[0] = UNDEFINED;
+		if (!this->trace_wrong_path && ir[0].opcode != EOP && ir[0].opcode != NOP){
+			unsigned next = this->trace_next;
+			if (next >= this->trace.size() || this->trace.pc(next) != thread.ProgramCount){
+				cerr << "error: the trace does not match the program at record " << next << "!" << endl;
+				exit(-1);
+			}
+			this->trace_record[0] = next;
+			if (advance){
+				this->trace_wrong_path = this->trace.taken(next);
+				this->trace_next += this->trace.has_value(next) ? 2 : 1;
+			}
+		}
+	}
+
+	if (!advance) return;
+	if (ir[0].opcode != EOP && ir[0].opcode != NOP){
+		thread.ProgramCount += 4;
+		pipelineRegisters[0].npc = thread.ProgramCount;
+	}
+	if (num_threads > 1){
+		if (ir[0].opcode == EOP) thread.fetched_eop = true;
+		fetch_thread = (fetch_policy == SWITCH_ON_STALL) ? t : (t + 1) % num_threads;
+	}
+}
+
+/* reads the source operands of the instruction in ID/EX from the register file */
+template <class Observer, class Config>
+void sim_pipe_core<Observer, Config>::read_operands() {
+
+	opcode_t opcode = ir[L_ID_EXE].opcode;
+	unsigned *regs = threads[pipelineRegisters[L_ID_EXE].thread].regs;
+
+	if(opcode == NOP || opcode == EOP){
+		pipelineRegisters[L_ID_EXE].a = UNDEFINED;
+		pipelineRegisters[L_ID_EXE].b = UNDEFINED;
+	}
+	else if (opcode == SW || is_int_r(opcode)){
+		pipelineRegisters[L_ID_EXE].a = regs[ir[L_ID_EXE].src1]; // pull value from register files
+		pipelineRegisters[L_ID_EXE].b = regs[ir[L_ID_EXE].src2];
+	}
+	else if (opcode == JUMP || is_vector_unit(opcode)){
+		// the vector operands are read in EX
+		pipelineRegisters[L_ID_EXE].a = UNDEFINED;
+		pipelineRegisters[L_ID_EXE].b = UNDEFINED;
+	}
+	else {
+		// LW, branches, ADDI, SUBI, vector memory instructions (base address)
+		pipelineRegisters[L_ID_EXE].a = regs[ir[L_ID_EXE].src1];
+		pipelineRegisters[L_ID_EXE].b = UNDEFINED;
+	}
+
+	pipelineRegisters[L_ID_EXE].imm = ir[L_ID_EXE].immediate;
+	if constexpr (observed) cycle_reg_reads += reads_src1(opcode) + reads_src2(opcode);
+}
+
+/* returns true if the instruction in ID/EX reads a register whose producer (of the same thread) has not made its value available yet */
+template <class Observer, class Config>
+bool sim_pipe_core<Observer, Config>::raw_hazard(stall_cause_t &cause) {
+
+	instruction_t &consumer = ir[L_ID_EXE];
+	unsigned thread = pipelineRegisters[L_ID_EXE].thread;
+	bool pending1 = reads_src1(consumer.opcode);
+	bool pending2 = reads_src2(consumer.opcode);
+
+	// the nearest producer of each source operand decides
+	for (unsigned l = L_ID_EXE+1; l <= L_MEM_WB && (pending1 || pending2); l++){
+		instruction_t &producer = ir[l];
+		if (!writes_register(producer.opcode) || pipelineRegisters[l].thread != thread) continue;
+		bool dep1 = pending1 && consumer.src1 == producer.dest;
+		bool dep2 = pending2 && consumer.src2 == producer.dest;
+		if (!dep1 && !dep2) continue;
+
+		bool ready = Config::forwarding && l >= (is_load(producer.opcode) ? L_MEM_WB : L_EXE_MEM);
+		if (!ready){
+			cause = is_load(producer.opcode) ? STALL_LOAD_USE : STALL_RAW;
+			return true;
+		}
+		if (dep1) pending1 = false;
+		if (dep2) pending2 = false;
+	}
+	return false;
+}
+
+/* value of general purpose register "reg" for the instruction entering EX: the youngest producer still in the pipeline, or the register file */
+template <class Observer, class Config>
+unsigned sim_pipe_core<Observer, Config>::forward_operand(unsigned reg) {
+
+	// EX has not written its output register yet: the ones after it hold the in-flight instructions
+	unsigned thread = pipelineRegisters[L_ID_EXE].thread;
+	for (unsigned l = L_ID_EXE+2; l <= L_MEM_WB; l++){
+		if (writes_register(ir[l].opcode) && ir[l].dest == reg && pipelineRegisters[l].thread == thread)
+			return (ir[l].opcode == LW) ? pipelineRegisters[l].lmd : pipelineRegisters[l].alu_out;
+	}
+	return threads[thread].regs[reg];
+}
+
+/* value of vector register "reg" (NUM_GP_REGISTERS+i) for the instruction in EX */
+template <class Observer, class Config>
+const vreg_t &sim_pipe_core<Observer, Config>::vector_operand(unsigned reg) {
+
+	// same as forward_operand: without forwarding, ID has waited for the producers to write back
+	unsigned thread = pipelineRegisters[L_ID_EXE].thread;
+	if constexpr (Config::forwarding){
+		for (unsigned l = L_ID_EXE+2; l <= L_MEM_WB; l++){
+			if (writes_vector(ir[l].opcode) && ir[l].dest == reg && pipelineRegisters[l].thread == thread)
+				return vresults[is_load(ir[l].opcode) ? pipelineRegisters[l].lmd : pipelineRegisters[l].alu_out];
+		}
+	}
+	return threads[thread].vregs[reg - NUM_GP_REGISTERS];
+}
+
+/* vector part of EX: element-wise operations and reductions, and the operand of vector stores */
+template <class Observer, class Config>
+void sim_pipe_core<Observer, Config>::vector_execute() {
+
+	instruction_t &instruction = ir[L_ID_EXE];
+	PipelineStage &out = pipelineRegisters[L_ID_EXE+1];
+
+	if (instruction.opcode == VREDSUM || instruction.opcode == VREDXOR){
+		vreg_t v = vector_operand(instruction.src1) & vector_mask;
+		unsigned result = 0;
+		for (unsigned i=0; i<MAX_VL; i++) result = (instruction.opcode == VREDSUM) ? result + v[i] : result ^ v[i];
+		out.alu_out = result;
+		return;
+	}
+
+	unsigned slot = next_vresult;
+	next_vresult = (next_vresult + 1) % MAX_STAGES;
+	vreg_t &result = vresults[slot];
+
+	switch(instruction.opcode){
+		case VADD:
+			result = (vector_operand(instruction.src1) + vector_operand(instruction.src2)) & vector_mask;
+			out.alu_out = slot;
+			break;
+		case VSUB:
+			result = (vector_operand(instruction.src1) - vector_operand(instruction.src2)) & vector_mask;
+			out.alu_out = slot;
+			break;
+		case VXOR:
+			result = (vector_operand(instruction.src1) ^ vector_operand(instruction.src2)) & vector_mask;
+			out.alu_out = slot;
+			break;
+		case VMUL:
+			result = (vector_operand(instruction.src1) * vector_operand(instruction.src2)) & vector_mask;
+			out.alu_out = slot;
+			break;
+		case VSW:
+		case VSWS:
+			result = vector_operand(instruction.src2);
+			out.b = slot;
+			break;
+		default:
+			// vector loads: MEM fills the entry
+			out.b = slot;
+			break;
+	}
+}
+
+/* vector part of MEM: VL elements from/to consecutive words (VLW/VSW) or every "immediate" bytes (VLWS/VSWS) */
+template <class Observer, class Config>
+void sim_pipe_core<Observer, Config>::vector_memory() {
+
+	instruction_t &instruction = ir[L_EXE_MEM];
+	unsigned address = pipelineRegisters[L_EXE_MEM].alu_out;
+	unsigned stride = (instruction.opcode == VLW || instruction.opcode == VSW) ? 4 : instruction.immediate;
+	unsigned slot = pipelineRegisters[L_EXE_MEM].b;
+	vreg_t &data = vresults[slot];
+
+	if (is_load(instruction.opcode)){
+		data = vreg_t{};
+		if (stride == 4) memcpy(&data, &data_memory[address], vector_length*sizeof(unsigned));
+		else for (unsigned i=0; i<vector_length; i++) data[i] = char2int(&data_memory[address + i*stride]);
+		pipelineRegisters[L_EXE_MEM+1].lmd = slot;
+	} else {
+		for (unsigned i=0; i<vector_length; i++) write_memory(address + i*stride, data[i]);
+		pipelineRegisters[L_EXE_MEM+1].lmd = UNDEFINED;
+	}
+	pipelineRegisters[L_EXE_MEM+1].alu_out = address;
+
+	if constexpr (observed){
+		for (unsigned i=0; i<vector_length; i++)
+			observer.on_memory(memory_event_t{clock_cycles, pipelineRegisters[L_EXE_MEM].pc, address + i*stride, (unsigned)data[i], !is_load(instruction.opcode)});
+	}
+}
+
+template <class Observer, class Config>
+void sim_pipe_core<Observer, Config>::instruction_decode() {
+
+	frontend_advance = !is_stall;
+
+	if(!is_stall){
+		//pass instruction to the ID/EX pipeline register and read operand values
+		ir[L_ID_EXE] = ir[L_ID_EXE-1];
+		pipelineRegisters[L_ID_EXE].pc = pipelineRegisters[L_ID_EXE-1].pc;
+		pipelineRegisters[L_ID_EXE].thread = pipelineRegisters[L_ID_EXE-1].thread;
+		if constexpr (Config::replay) this->trace_record[L_ID_EXE] = this->trace_record[L_ID_EXE-1];
+		read_operands();
+	} else {
+		
+		//stall
+		stalls++;
+		threads[pipelineRegisters[L_ID_EXE].thread].stalls++;
+		profile.stall(instr_index(pipelineRegisters[L_ID_EXE].pc), stall_cause);
+		if constexpr (observed) observer.on_stall(stall_event_t{clock_cycles, pipelineRegisters[L_ID_EXE].pc, stall_cause});
+		
+	}
+
+	// look for RAW stall conditions
+	if(raw_hazard(stall_cause)){
+		// SWITCH_ON_STALL: another thread takes the pipeline instead of waiting
+		if (fetch_policy == SWITCH_ON_STALL && num_threads > 1 && frontend_advance && switch_thread()) return;
+		is_stall = true;
+		pipelineRegisters[L_ID_EXE].npc = UNDEFINED;
+		pipelineRegisters[L_ID_EXE].a = UNDEFINED;
+		pipelineRegisters[L_ID_EXE].b = UNDEFINED;
+		pipelineRegisters[L_ID_EXE].imm = UNDEFINED;
+		return;
+
+	} else if (is_stall) {
+
+		// the producers have made their values available: read the operands again
+		read_operands();
+		is_stall = false;
+		pipelineRegisters[L_ID_EXE].npc = pipelineRegisters[L_ID_EXE].pc + 4;
+		return;
+
+	}
+
+	pipelineRegisters[L_ID_EXE].npc = pipelineRegisters[L_ID_EXE-1].npc;
+
+}
+
+template <class Observer, class Config>
+void sim_pipe_core<Observer, Config>::execute_stage() {
+
+	unsigned A = pipelineRegisters[L_ID_EXE].a;
+	unsigned B = pipelineRegisters[L_ID_EXE].b;		
+	unsigned immediate = pipelineRegisters[L_ID_EXE].imm;
+	unsigned npc = pipelineRegisters[L_ID_EXE].npc;
+	instruction_t &instruction = ir[L_ID_EXE];
+
+	// trace replay: the recorded data address (or branch target) and branch outcome replace the ALU
+	unsigned record = UNDEFINED;
+	if constexpr (Config::replay) record = this->trace_record[L_ID_EXE];
+
+	if constexpr (Config::forwarding && !Config::replay){
+		if (reads_src1(instruction.opcode) && instruction.src1 < NUM_GP_REGISTERS) A = forward_operand(instruction.src1);
+		if (reads_src2(instruction.opcode) && instruction.src2 < NUM_GP_REGISTERS) B = forward_operand(instruction.src2);
+	}
+
+	unsigned alu_result;
+	if constexpr (Config::replay) alu_result = (record == UNDEFINED) ? UNDEFINED : this->trace.address(record);
+	else alu_result = alu(instruction.opcode, A, B, immediate, npc);
+
+	// the vector unit holds EX, and the stages before it, until the operation completes
+	ex_stall = !is_stall && is_vector_unit(instruction.opcode) && vector_wait();
+
+	if(!is_stall && !ex_stall){	
+		//recieve instruction and operands from pipeline register
+		
+	
+		//check if branch
+		bool is_taken_branch;
+		if constexpr (Config::replay) is_taken_branch = (record != UNDEFINED) && this->trace.taken(record);
+		else is_taken_branch = taken_branch(instruction.opcode, A);
+		
+		pipelineRegisters[L_ID_EXE+1].pc = pipelineRegisters[L_ID_EXE].pc;
+		pipelineRegisters[L_ID_EXE+1].thread = pipelineRegisters[L_ID_EXE].thread;
+		if constexpr (Config::replay) this->trace_record[L_ID_EXE+1] = this->trace_record[L_ID_EXE];
+		pipelineRegisters[L_ID_EXE+1].alu_out = alu_result;
+		pipelineRegisters[L_ID_EXE+1].b = B;
+
+		pipelineRegisters[L_ID_EXE+1].cond = is_taken_branch;
+
+		ir[L_ID_EXE+1] = ir[L_ID_EXE];
+
+		if (!Config::replay && is_vector(instruction.opcode)) vector_execute();
+
+		if constexpr (observed){
+			cycle_alu_op = instruction.opcode;
+			cycle_alu_elements = is_vector_unit(instruction.opcode) ? vector_length : 1;
+		}
+
+	} else {
+		ir[L_ID_EXE+1].opcode = NOP;
+		ir[L_ID_EXE+1].src1 = UNDEFINED;
+		ir[L_ID_EXE+1].src2 = UNDEFINED;
+		ir[L_ID_EXE+1].dest = UNDEFINED;
+		ir[L_ID_EXE+1].immediate = UNDEFINED;
+		pipelineRegisters[L_ID_EXE+1].alu_out = UNDEFINED;
+		pipelineRegisters[L_ID_EXE+1].b = UNDEFINED;
+		pipelineRegisters[L_ID_EXE+1].cond = false;
+
+		if (ex_stall){
+			stalls++;
+			threads[pipelineRegisters[L_ID_EXE].thread].stalls++;
+			profile.stall(instr_index(pipelineRegisters[L_ID_EXE].pc), STALL_VECTOR);
+			if constexpr (observed) observer.on_stall(stall_event_t{clock_cycles, pipelineRegisters[L_ID_EXE].pc, STALL_VECTOR});
+		}
+	}
+}	
+
+template <class Observer, class Config>
+void sim_pipe_core<Observer, Config>::memory_stage(){
+
+	unsigned ALUOutput = pipelineRegisters[L_EXE_MEM].alu_out;
+	instruction_t &instruction = ir[L_EXE_MEM];
+
+	// an access outside data memory stops the run before it reaches the memory port: the pipeline holds
+	if ((is_memory(instruction.opcode) && !is_io(ALUOutput) && !in_data_memory(ALUOutput)) ||
+	    (is_vector_memory(instruction.opcode) && !vector_in_data_memory(ALUOutput, (instruction.opcode == VLW || instruction.opcode == VSW) ? 4 : instruction.immediate))){
+		memory_fault = ALUOutput;
+		memory_fault_pc = pipelineRegisters[L_EXE_MEM].pc;
+		mem_stall = true;
+		return;
+	}
+
+	// data memory accesses wait for the memory port and its latency: MEM sends bubbles to WB meanwhile
+	// (a vector access is a sequence of accesses, it never reaches the devices)
+	if (is_vector_memory(instruction.opcode))
+		mem_stall = port_wait((instruction.opcode == VLW || instruction.opcode == VSW) ? (vector_length + vector_lanes - 1) / vector_lanes : vector_length);
+	else if (instruction.opcode == LW && !is_io(ALUOutput) && prefetcher.enabled())
+		mem_stall = load_wait(pipelineRegisters[L_EXE_MEM].pc, ALUOutput);
+	else mem_stall = is_memory(instruction.opcode) && !is_io(ALUOutput) && port_wait();
+	if (mem_stall){
+		ir[L_EXE_MEM+1].opcode = NOP;
+		ir[L_EXE_MEM+1].src1 = UNDEFINED;
+		ir[L_EXE_MEM+1].src2 = UNDEFINED;
+		ir[L_EXE_MEM+1].dest = UNDEFINED;
+		ir[L_EXE_MEM+1].immediate = UNDEFINED;
+		pipelineRegisters[L_EXE_MEM+1].alu_out = UNDEFINED;
+		pipelineRegisters[L_EXE_MEM+1].lmd = UNDEFINED;
+		pipelineRegisters[L_EXE_MEM+1].cond = false;
+
+		stalls++;
+		threads[pipelineRegisters[L_EXE_MEM].thread].stalls++;
+		profile.stall(instr_index(pipelineRegisters[L_EXE_MEM].pc), STALL_MEMORY);
+		if constexpr (observed) observer.on_stall(stall_event_t{clock_cycles, pipelineRegisters[L_EXE_MEM].pc, STALL_MEMORY});
+		return;
+	}
+
+	if constexpr (Config::replay) {
+		// trace replay: no data is read or written, except the values stored to the devices
+		unsigned record = this->trace_record[L_EXE_MEM];
+		if (instruction.opcode == SW && is_io(ALUOutput) && this->trace.has_value(record)) {
+			devices.write(ALUOutput - io_base, this->trace.address(record + 1), clock_cycles);
+			pipelineRegisters[L_EXE_MEM+1].b = this->trace.address(record + 1);
+		}
+		pipelineRegisters[L_EXE_MEM+1].alu_out = ALUOutput;
+		pipelineRegisters[L_EXE_MEM+1].lmd = UNDEFINED;
+	}
+	else if (is_vector_memory(instruction.opcode)) {
+		vector_memory();
+	}
+	else if (instruction.opcode == LW && is_io(ALUOutput)) {
+		unsigned LMD = devices.read(ALUOutput - io_base, clock_cycles);
+		pipelineRegisters[L_EXE_MEM+1].lmd = LMD;
+		pipelineRegisters[L_EXE_MEM+1].alu_out = ALUOutput;
+		if constexpr (observed) observer.on_memory(memory_event_t{clock_cycles, pipelineRegisters[L_EXE_MEM].pc, ALUOutput, LMD, false});
+	}
+	else if (instruction.opcode == SW && is_io(ALUOutput)) {
+		devices.write(ALUOutput - io_base, pipelineRegisters[L_EXE_MEM].b, clock_cycles);
+		if constexpr (observed) pipelineRegisters[L_EXE_MEM+1].b = pipelineRegisters[L_EXE_MEM].b; //stored value of the retire event
+		pipelineRegisters[L_EXE_MEM+1].lmd = UNDEFINED;
+		pipelineRegisters[L_EXE_MEM+1].alu_out = ALUOutput;
+		if constexpr (observed) observer.on_memory(memory_event_t{clock_cycles, pipelineRegisters[L_EXE_MEM].pc, ALUOutput, pipelineRegisters[L_EXE_MEM].b, true});
+	}
+	else if (instruction.opcode == LW) {
+		unsigned LMD = char2int(&data_memory[ALUOutput]);
+		pipelineRegisters[L_EXE_MEM+1].lmd = LMD;
+		pipelineRegisters[L_EXE_MEM+1].alu_out = ALUOutput;
+		if constexpr (observed) observer.on_memory(memory_event_t{clock_cycles, pipelineRegisters[L_EXE_MEM].pc, ALUOutput, LMD, false});
+	}
+	else if (instruction.opcode == SW){
+		write_memory(ALUOutput, pipelineRegisters[L_EXE_MEM].b);
+		pipelineRegisters[L_EXE_MEM+1].lmd = UNDEFINED;
+		pipelineRegisters[L_EXE_MEM+1].alu_out = ALUOutput;
+		if constexpr (observed) observer.on_memory(memory_event_t{clock_cycles, pipelineRegisters[L_EXE_MEM].pc, ALUOutput, pipelineRegisters[L_EXE_MEM].b, true});
+	} 
+	else {
+		pipelineRegisters[L_EXE_MEM+1].alu_out = ALUOutput;
+		pipelineRegisters[L_EXE_MEM+1].lmd = UNDEFINED;
+	}
+
+	pipelineRegisters[L_EXE_MEM+1].pc = pipelineRegisters[L_EXE_MEM].pc;
+	pipelineRegisters[L_EXE_MEM+1].thread = pipelineRegisters[L_EXE_MEM].thread;
+	if constexpr (Config::replay) this->trace_record[L_EXE_MEM+1] = this->trace_record[L_EXE_MEM];
+	pipelineRegisters[L_EXE_MEM+1].cond = pipelineRegisters[L_EXE_MEM].cond;
+	ir[L_EXE_MEM+1] = ir[L_EXE_MEM];
+
+	// taken branch: redirect fetch of its thread to the target and squash the wrong-path instructions
+	if (is_branch(instruction.opcode) && pipelineRegisters[L_EXE_MEM].cond){
+		threads[pipelineRegisters[L_EXE_MEM].thread].ProgramCount = ALUOutput;
+		pipe_flush();
+	}
+
+}
+
+template <class Observer, class Config>
+void sim_pipe_core<Observer, Config>::write_back(){
+
+	unsigned ALUOut = pipelineRegisters[L_MEM_WB].alu_out;
+	instruction_t &instruction = ir[L_MEM_WB];
+	unsigned LMD = pipelineRegisters[L_MEM_WB].lmd;
+	unsigned dest = instruction.dest;
+	ThreadContext &thread = threads[pipelineRegisters[L_MEM_WB].thread];
+
+	if (instruction.opcode == NOP){
+		return;
+	}
+	else if constexpr (Config::replay) {
+		// trace replay: the registers are not written
+	}
+	else if (instruction.opcode == LW) {
+		thread.regs[dest] = LMD;
+	}	
+	else if (writes_vector(instruction.opcode)) {
+		thread.vregs[dest - NUM_GP_REGISTERS] = vresults[is_load(instruction.opcode) ? LMD : ALUOut];
+	}
+	else if (writes_register(instruction.opcode)) {
+		thread.regs[dest] = ALUOut;
+	}
+
+	instructions_executed++;
+	thread.instructions_executed++;
+	profile.retire(instr_index(pipelineRegisters[L_MEM_WB].pc));
+	if constexpr (observed){
+		opcode_t opcode = instruction.opcode;
+		unsigned result = (!Config::replay && writes_register(opcode) && !writes_vector(opcode)) ? thread.regs[dest] : UNDEFINED;
+		unsigned address = (is_memory(opcode) || is_vector_memory(opcode) || is_branch(opcode)) ? ALUOut : UNDEFINED;
+		unsigned stored = (opcode == SW && is_io(ALUOut)) ? pipelineRegisters[L_MEM_WB].b : UNDEFINED;
+		observer.on_retire(retire_event_t{clock_cycles, pipelineRegisters[L_MEM_WB].pc, &ir[L_MEM_WB], result, address, is_branch(opcode) && pipelineRegisters[L_MEM_WB].cond, stored});
+	}
+}
+
+/* squashes the instructions of "thread" in pipeline registers 0 to "last" */
+template <class Observer, class Config>
+void sim_pipe_core<Observer, Config>::squash_thread(unsigned thread, unsigned last){
+
+	for (unsigned i=0; i<=last; i++){
+		if (pipelineRegisters[i].thread != thread) continue;
+		ir[i].opcode = NOP;
+		ir[i].src1 = UNDEFINED;
+		ir[i].src2 = UNDEFINED;
+		ir[i].dest = UNDEFINED;
+		ir[i].immediate = UNDEFINED;
+		pipelineRegisters[i].npc = UNDEFINED;
+		pipelineRegisters[i].a = UNDEFINED;
+		pipelineRegisters[i].b = UNDEFINED;
+		pipelineRegisters[i].imm = UNDEFINED;
+	}
+}
+
+/* SWITCH_ON_STALL: the stalled instruction and the younger ones of its thread are fetched again later */
+template <class Observer, class Config>
+bool sim_pipe_core<Observer, Config>::switch_thread(){
+
+	unsigned t = pipelineRegisters[L_ID_EXE].thread;
+	bool other = false;
+	for (unsigned u=0; u<num_threads; u++) other = other || (u != t && !threads[u].fetched_eop);
+	if (!other) return false;
+
+	threads[t].ProgramCount = pipelineRegisters[L_ID_EXE].pc;
+	threads[t].fetched_eop = false;
+	threads[t].switches++;
+	squash_thread(t, L_ID_EXE);
+	fetch_thread = (t + 1) % num_threads;
+	return true;
+}
+
+/* squashes the instructions fetched after a taken branch (every pipeline register before EX/MEM holding an instruction of its thread) */
+template <class Observer, class Config>
+void sim_pipe_core<Observer, Config>::pipe_flush(){
+
+	unsigned t = pipelineRegisters[L_EXE_MEM+1].thread;
+	unsigned slots = 0;
+	for (unsigned i=0; i<L_EXE_MEM; i++) slots += (pipelineRegisters[i].thread == t);
+	squash_thread(t, L_EXE_MEM-1);
+	if (pipelineRegisters[L_ID_EXE].thread == t){
+		is_stall = false;
+		vector_done = UNDEFINED; // a squashed vector operation releases the vector unit
+	}
+	threads[t].fetched_eop = false;
+	if constexpr (Config::replay) this->trace_wrong_path = false;
+
+	unsigned branch_pc = pipelineRegisters[L_EXE_MEM+1].pc;
+	profile.flush(instr_index(branch_pc), slots);
+	if constexpr (observed) observer.on_flush(flush_event_t{clock_cycles, branch_pc, threads[t].ProgramCount, slots});
+}
+
+#endif /*SIM_PIPE_CORE_H_*/
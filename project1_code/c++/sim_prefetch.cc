@@ -0,0 +1,205 @@
+#include "sim_prefetch.h"
+#include "sim_pipe.h"
+#include <iostream>
+#include <iomanip>
+#include <stdlib.h>
+
+using namespace std;
+
+static const char *prefetcher_names[] = {"none", "next line", "stride", "stream"};
+
+sim_prefetcher::sim_prefetcher(){
+	configure(PREFETCH_NONE, 1, 1, 8, 16, 16, 0);
+}
+
+void sim_prefetcher::configure(prefetch_kind_t prefetcher, unsigned pf_degree, unsigned pf_distance, unsigned pf_queue_size,
+	unsigned pf_buffer_size, unsigned block, unsigned mem_size){
+	if (pf_degree < 1 || pf_distance < 1 || pf_queue_size < 1 || pf_buffer_size < 1 || block < 4 || block % 4) {
+		cerr << "error: invalid prefetcher (degree " << pf_degree << ", distance " << pf_distance << ", queue " << pf_queue_size;
+		cerr << ", buffer " << pf_buffer_size << ", block " << block << ")!" << endl;
+		exit(-1);
+	}
+	kind = prefetcher;
+	degree = pf_degree;
+	distance = pf_distance;
+	queue_size = pf_queue_size;
+	buffer_size = pf_buffer_size;
+	block_size = block;
+	memory_size = mem_size;
+	reset();
+}
+
+void sim_prefetcher::reset(){
+	buffer_entry_t empty = {UNDEFINED, 0, 0, false};
+	buffer.assign(buffer_size, empty);
+	queue.clear();
+	for (unsigned i=0; i<STRIDE_ENTRIES; i++) stride_table[i] = stride_entry_t{UNDEFINED, 0, 0, false};
+	for (unsigned i=0; i<STREAM_BUFFERS; i++) streams[i] = stream_t{0, 0, 0, false};
+	loads = timely_hits = late_hits = late_cycles = 0;
+	issued = useful = dropped = port_cycles = 0;
+}
+
+sim_prefetcher::buffer_entry_t *sim_prefetcher::find(unsigned block){
+	for (unsigned i=0; i<buffer_size; i++)
+		if (buffer[i].block == block) return &buffer[i];
+	return NULL;
+}
+
+void sim_prefetcher::request(long long address){
+	if (address < 0 || address >= memory_size) return;
+	unsigned block = address / block_size;
+	if (find(block) != NULL) return;
+	for (unsigned i=0; i<queue.size(); i++)
+		if (queue[i] == block) return;
+	if (queue.size() >= queue_size) {
+		dropped++;
+		return;
+	}
+	queue.push_back(block);
+}
+
+void sim_prefetcher::train(unsigned pc, unsigned address, bool miss, unsigned cycle){
+	unsigned block = address / block_size;
+	switch(kind){
+		case PREFETCH_NEXT_LINE:
+			for (unsigned i=0; i<degree; i++) request((long long)(block + distance + i) * block_size);
+			break;
+		case PREFETCH_STRIDE: {
+			stride_entry_t &entry = stride_table[(pc >> 2) % STRIDE_ENTRIES];
+			if (entry.pc != pc) {
+				entry = stride_entry_t{pc, address, 0, false};
+				break;
+			}
+			int stride = (int)(address - entry.address);
+			entry.confirmed = (stride != 0 && stride == entry.stride);
+			entry.stride = stride;
+			entry.address = address;
+			if (entry.confirmed)
+				for (unsigned i=0; i<degree; i++) request((long long)address + (long long)stride * (distance + i));
+			break;
+		}
+		case PREFETCH_STREAM: {
+			stream_t *stream = NULL;
+			for (unsigned s=0; s<STREAM_BUFFERS; s++)
+				if (streams[s].valid && block >= streams[s].last && block <= streams[s].next) stream = &streams[s];
+			if (stream == NULL) {
+				if (!miss) break;
+				// a miss outside every stream starts a new one
+				stream = &streams[0];
+				for (unsigned s=0; s<STREAM_BUFFERS; s++){
+					if (!streams[s].valid) {
+						stream = &streams[s];
+						break;
+					}
+					if (streams[s].last_use < stream->last_use) stream = &streams[s];
+				}
+				stream->valid = true;
+				stream->next = block + distance;
+			}
+			stream->last = block;
+			stream->last_use = cycle;
+			if (stream->next < block + distance) stream->next = block + distance;
+			while (stream->next < block + distance + degree) request((long long)(stream->next++) * block_size);
+			break;
+		}
+		default:
+			break;
+	}
+}
+
+unsigned sim_prefetcher::load(unsigned pc, unsigned address, unsigned cycle){
+	unsigned block = address / block_size;
+	unsigned ready = UNDEFINED;
+	loads++;
+	buffer_entry_t *entry = find(block);
+	if (entry != NULL) {
+		if (!entry->used) useful++;
+		entry->used = true;
+		entry->last_use = cycle;
+		ready = entry->ready;
+		if (ready > cycle) {
+			late_hits++;
+			late_cycles += ready - cycle;
+		} else timely_hits++;
+	} else {
+		// the load reads the block itself: a queued prefetch of it would come too late
+		for (unsigned i=0; i<queue.size(); i++)
+			if (queue[i] == block) {
+				queue.erase(queue.begin() + i);
+				break;
+			}
+	}
+	train(pc, address, entry == NULL, cycle);
+	return ready;
+}
+
+void sim_prefetcher::step(unsigned cycle, unsigned &port_free, unsigned latency){
+	if (port_free > cycle) return;
+	unsigned cycles = latency + block_size / 4;
+	port_free = cycle + cycles;
+	port_cycles += cycles;
+	issued++;
+
+	// the block replaces an empty entry of the buffer, or else the least recently used one
+	buffer_entry_t *victim = &buffer[0];
+	for (unsigned i=0; i<buffer_size; i++){
+		if (buffer[i].block == UNDEFINED) {
+			victim = &buffer[i];
+			break;
+		}
+		if (buffer[i].last_use < victim->last_use) victim = &buffer[i];
+	}
+	*victim = buffer_entry_t{queue.front(), cycle + cycles - 1, cycle, false};
+	queue.pop_front();
+}
+
+void sim_prefetcher::add_config(sim_hash &h){
+	h.add(kind);
+	if (kind == PREFETCH_NONE) return;
+	h.add(degree);
+	h.add(distance);
+	h.add(queue_size);
+	h.add(buffer_size);
+	h.add(block_size);
+}
+
+const char *sim_prefetcher::get_name(){return prefetcher_names[kind];}
+
+unsigned sim_prefetcher::get_loads(){return loads;}
+
+unsigned sim_prefetcher::get_hits(){return timely_hits + late_hits;}
+
+unsigned sim_prefetcher::get_late_hits(){return late_hits;}
+
+unsigned sim_prefetcher::get_issued(){return issued;}
+
+unsigned sim_prefetcher::get_useful(){return useful;}
+
+unsigned sim_prefetcher::get_dropped(){return dropped;}
+
+unsigned sim_prefetcher::get_port_cycles(){return port_cycles;}
+
+double sim_prefetcher::get_accuracy(){return issued ? (double)useful / issued : 0;}
+
+double sim_prefetcher::get_coverage(){return loads ? (double)get_hits() / loads : 0;}
+
+double sim_prefetcher::get_timeliness(){return get_hits() ? (double)timely_hits / get_hits() : 0;}
+
+void sim_prefetcher::print_report(){
+	cout << "PREFETCHER: " << get_name();
+	if (kind != PREFETCH_NONE) {
+		cout << " (degree " << degree << ", distance " << distance << ", queue " << queue_size;
+		cout << ", buffer " << buffer_size << " x " << block_size << " bytes)";
+	}
+	cout << endl;
+	cout << "Loads = " << dec << loads << endl;
+	cout << "Prefetch buffer hits = " << get_hits() << " (on time " << timely_hits << ", late " << late_hits;
+	cout << ", " << late_cycles << " cycles waited)" << endl;
+	cout << "Prefetches issued = " << issued << " (useful " << useful << ", dropped " << dropped << ")" << endl;
+	cout << "Memory port cycles used by prefetches = " << port_cycles << endl;
+	cout << fixed << setprecision(1);
+	cout << "Accuracy = " << 100 * get_accuracy() << "%" << endl;
+	cout << "Coverage = " << 100 * get_coverage() << "%" << endl;
+	cout << "Timeliness = " << 100 * get_timeliness() << "%" << endl;
+	cout << defaultfloat << setprecision(6);
+}
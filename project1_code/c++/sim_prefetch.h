@@ -0,0 +1,138 @@
+#ifndef SIM_PREFETCH_H_
+#define SIM_PREFETCH_H_
+
+#include <vector>
+#include <deque>
+#include "sim_cache.h"
+
+using namespace std;
+
+// prefetchers
+typedef enum {PREFETCH_NONE, PREFETCH_NEXT_LINE, PREFETCH_STRIDE, PREFETCH_STREAM} prefetch_kind_t;
+
+#define STRIDE_ENTRIES 16 // entries of the PC-indexed stride table
+#define STREAM_BUFFERS 4  // streams followed by the stream prefetcher
+
+/*
+Hardware data prefetcher in front of the data memory.
+
+The prefetcher watches the loads of the MEM stage and guesses the blocks (of "block" bytes)
+they will read next:
+- next line: the "degree" blocks starting "distance" blocks after the block loaded
+- stride: a table indexed by the PC of the load holds its last address and stride; once the
+  same stride is seen twice in a row, the addresses "distance" to "distance"+"degree"-1 strides
+  ahead are prefetched
+- stream: a load that misses allocates a stream (the least recently used one is replaced);
+  the loads that follow it in increasing block order keep "degree" blocks prefetched, the
+  first one "distance" blocks ahead of the load
+
+The guessed blocks wait in a queue of "queue_size" entries (new ones are dropped when it is
+full) for the memory port, which they get only in the cycles the core and the DMA engine
+leave it free. A prefetch holds the port for the data memory latency plus one cycle per word
+of the block, and its block then goes to a prefetch buffer of "buffer_size" blocks (the least
+recently used one is replaced). A load whose block is in the buffer does not use the port:
+it completes as soon as the block has arrived - late if it had to wait for it.
+
+Only the timing is modeled (loads read the data memory itself), stores and vector accesses
+go to the memory port as before and do not train the prefetcher.
+*/
+class sim_prefetcher{
+
+	// entry of the prefetch buffer
+	typedef struct{
+		unsigned block;
+		unsigned ready; // cycle the block arrives
+		unsigned last_use; // cycle of the last load that used it (or of the prefetch)
+		bool used;
+	} buffer_entry_t;
+
+	// entry of the stride table
+	typedef struct{
+		unsigned pc;
+		unsigned address;
+		int stride;
+		bool confirmed;
+	} stride_entry_t;
+
+	// stream: last block loaded and next block to prefetch
+	typedef struct{
+		unsigned last;
+		unsigned next;
+		unsigned last_use;
+		bool valid;
+	} stream_t;
+
+	// configuration
+	prefetch_kind_t kind;
+	unsigned degree, distance, queue_size, buffer_size, block_size;
+	unsigned memory_size;
+
+	// state
+	vector<buffer_entry_t> buffer;
+	deque<unsigned> queue;
+	stride_entry_t stride_table[STRIDE_ENTRIES];
+	stream_t streams[STREAM_BUFFERS];
+
+	// statistics
+	unsigned loads, timely_hits, late_hits, late_cycles;
+	unsigned issued, useful, dropped, port_cycles;
+
+	//returns the buffer entry of "block" (NULL if it is not in the buffer)
+	buffer_entry_t *find(unsigned block);
+
+	//queues a prefetch of the block of "address" unless it is buffered or queued already
+	void request(long long address);
+
+	//trains the prefetcher with the load of "address" by the instruction at "pc"
+	void train(unsigned pc, unsigned address, bool miss, unsigned cycle);
+
+public:
+
+	sim_prefetcher();
+
+	//selects the prefetcher and its parameters (see above), and resets it - "block" is in bytes (multiple of 4),
+	//"mem_size" the size of the data memory (nothing is prefetched beyond it)
+	void configure(prefetch_kind_t prefetcher, unsigned degree, unsigned distance, unsigned queue_size,
+		unsigned buffer_size, unsigned block, unsigned mem_size);
+
+	//empties the buffer, the queue and the tables and resets the statistics (the configuration is kept)
+	void reset();
+
+	//true if a prefetcher is selected
+	inline bool enabled(){ return kind != PREFETCH_NONE; }
+
+	//true while prefetches wait for the memory port
+	inline bool active(){ return !queue.empty(); }
+
+	//load of "address" by the instruction at "pc" in clock cycle "cycle": returns the cycle the data
+	//is available from the prefetch buffer, or UNDEFINED if the load must access the memory
+	unsigned load(unsigned pc, unsigned address, unsigned cycle);
+
+	//issues the prefetch at the head of the queue in clock cycle "cycle" if the memory port is free
+	//("port_free" is the first cycle the port is not used, updated when the prefetcher takes it)
+	void step(unsigned cycle, unsigned &port_free, unsigned latency);
+
+	//adds the configuration to the result cache key
+	void add_config(sim_hash &h);
+
+	//returns the name of the selected prefetcher
+	const char *get_name();
+
+	//prefetch statistics
+	unsigned get_loads();        // loads seen
+	unsigned get_hits();         // loads served by the prefetch buffer
+	unsigned get_late_hits();    // ... that waited for their block to arrive
+	unsigned get_issued();       // prefetches issued to the memory
+	unsigned get_useful();       // ... whose block was used by a load
+	unsigned get_dropped();      // prefetches dropped because the queue was full
+	unsigned get_port_cycles();  // cycles the prefetches held the memory port
+
+	double get_accuracy();       // useful / issued
+	double get_coverage();       // hits / loads
+	double get_timeliness();     // hits on time / hits
+
+	//prints the configuration and the statistics
+	void print_report();
+};
+
+#endif /*SIM_PREFETCH_H_*/
@@ -0,0 +1,188 @@
+#include "sim_profile.h"
+#include <iostream>
+#include <fstream>
+#include <iomanip>
+#include <stdlib.h>
+
+using namespace std;
+
+static const char *stall_cause_names[NUM_STALL_CAUSES] = {"RAW", "LOAD-USE", "MEMORY", "VECTOR"};
+
+/* =============================================================
+
+   HELPER FUNCTIONS
+
+   ============================================================= */
+
+/* returns the label of the region (code between two labels) the instruction belongs to */
+static string region_of(unsigned idx, map<unsigned, string> &labels){
+	map<unsigned, string>::iterator it = labels.upper_bound(idx);
+	if (it == labels.begin()) return "<entry>";
+	--it;
+	return it->second;
+}
+
+/* returns the instruction text with blanks replaced, so that it can be used as a stack frame */
+static string frame_name(const string &text){
+	string frame = text;
+	for (unsigned i=0; i<frame.length(); i++)
+		if (frame[i] == ' ' || frame[i] == '\t' || frame[i] == ';') frame[i] = '_';
+	return frame;
+}
+
+/* prints a percentage of the total cycles */
+static void print_percent(unsigned cycles, unsigned total){
+	cout << setw(7) << setfill(' ') << fixed << setprecision(2) << (total ? 100.0*cycles/total : 0.0) << "%";
+}
+
+/* =============================================================
+
+   PROFILER
+
+   ============================================================= */
+
+sim_profile::sim_profile(unsigned program_size){
+	size = program_size;
+	retired = new unsigned[size];
+	for (int c=0; c<NUM_STALL_CAUSES; c++) stalls[c] = new unsigned[size];
+	flushes = new unsigned[size];
+	reset();
+}
+
+sim_profile::~sim_profile(){
+	delete [] retired;
+	for (int c=0; c<NUM_STALL_CAUSES; c++) delete [] stalls[c];
+	delete [] flushes;
+}
+
+void sim_profile::reset(){
+	reset(size);
+}
+
+void sim_profile::reset(unsigned count){
+	if (count > size) count = size;
+	memset(retired, 0, count*sizeof(unsigned));
+	for (int c=0; c<NUM_STALL_CAUSES; c++) memset(stalls[c], 0, count*sizeof(unsigned));
+	memset(flushes, 0, count*sizeof(unsigned));
+}
+
+void sim_profile::save(unsigned count, vector<unsigned> &state){
+	if (count > size) count = size;
+	state.assign(retired, retired + count);
+	for (int c=0; c<NUM_STALL_CAUSES; c++) state.insert(state.end(), stalls[c], stalls[c] + count);
+	state.insert(state.end(), flushes, flushes + count);
+}
+
+void sim_profile::restore(unsigned count, const vector<unsigned> &state){
+	if (count > size) count = size;
+	const unsigned *saved = state.data();
+	memcpy(retired, saved, count*sizeof(unsigned));
+	for (int c=0; c<NUM_STALL_CAUSES; c++) memcpy(stalls[c], saved + (c+1)*count, count*sizeof(unsigned));
+	memcpy(flushes, saved + (NUM_STALL_CAUSES+1)*count, count*sizeof(unsigned));
+}
+
+unsigned sim_profile::get_retired(unsigned idx){return idx < size ? retired[idx] : 0;}
+
+unsigned sim_profile::get_stalls(unsigned idx, stall_cause_t cause){return idx < size ? stalls[cause][idx] : 0;}
+
+unsigned sim_profile::get_flushes(unsigned idx){return idx < size ? flushes[idx] : 0;}
+
+unsigned sim_profile::get_cycles(unsigned idx){
+	if (idx >= size) return 0;
+	unsigned cycles = retired[idx] + flushes[idx];
+	for (int c=0; c<NUM_STALL_CAUSES; c++) cycles += stalls[c][idx];
+	return cycles;
+}
+
+/* prints the annotated listing, then the basic block and label summaries */
+void sim_profile::print(const string *text, unsigned count, const bool *block_leader, map<unsigned, string> &labels, unsigned base_address){
+
+	if (count > size) count = size;
+
+	unsigned total = 0;
+	for (unsigned i=0; i<count; i++) total += get_cycles(i);
+
+	ios::fmtflags flags = cout.flags();
+	streamsize precision = cout.precision();
+
+	/* annotated listing */
+	cout << setfill(' ');
+	cout << "Profile: annotated listing (cycles = retired + stall cycles + flushed slots)" << endl;
+	cout << "PC         " << setw(9) << "retired";
+	for (int c=0; c<NUM_STALL_CAUSES; c++) cout << setw(10) << stall_cause_names[c];
+	cout << setw(9) << "flush" << setw(10) << "cycles" << setw(8) << "%" << "  instruction" << endl;
+	for (unsigned i=0; i<count; i++){
+		if (labels.count(i)) cout << labels[i] << ":" << endl;
+		else if (block_leader[i] && i) cout << "  --" << endl;
+		cout << "0x" << hex << setw(8) << setfill('0') << base_address + (i<<2) << dec << setfill(' ');
+		cout << " " << setw(9) << retired[i];
+		for (int c=0; c<NUM_STALL_CAUSES; c++) cout << setw(10) << stalls[c][i];
+		cout << setw(9) << flushes[i] << setw(10) << get_cycles(i);
+		print_percent(get_cycles(i), total);
+		cout << "  " << text[i] << endl;
+	}
+
+	/* basic blocks */
+	cout << endl << "Profile: basic blocks" << endl;
+	cout << "first PC   last PC    " << setw(7) << "instrs" << setw(10) << "retired" << setw(10) << "stalls" << setw(9) << "flush" << setw(10) << "cycles" << setw(8) << "%" << "  region" << endl;
+	for (unsigned first=0; first<count; ){
+		unsigned last = first;
+		while (last+1 < count && !block_leader[last+1]) last++;
+		unsigned r = 0, s = 0, f = 0, cycles = 0;
+		for (unsigned i=first; i<=last; i++){
+			r += retired[i];
+			for (int c=0; c<NUM_STALL_CAUSES; c++) s += stalls[c][i];
+			f += flushes[i];
+			cycles += get_cycles(i);
+		}
+		cout << "0x" << hex << setw(8) << setfill('0') << base_address + (first<<2) << " 0x" << setw(8) << base_address + (last<<2) << dec << setfill(' ');
+		cout << " " << setw(7) << last-first+1 << setw(10) << r << setw(10) << s << setw(9) << f << setw(10) << cycles;
+		print_percent(cycles, total);
+		cout << "  " << region_of(first, labels) << endl;
+		first = last+1;
+	}
+
+	/* labels */
+	cout << endl << "Profile: labels" << endl;
+	cout << setw(16) << left << "label" << right << setw(10) << "retired" << setw(10) << "stalls" << setw(9) << "flush" << setw(10) << "cycles" << setw(8) << "%" << endl;
+	for (unsigned first=0; first<count; ){
+		string region = region_of(first, labels);
+		unsigned last = first;
+		while (last+1 < count && !labels.count(last+1)) last++;
+		unsigned r = 0, s = 0, f = 0, cycles = 0;
+		for (unsigned i=first; i<=last; i++){
+			r += retired[i];
+			for (int c=0; c<NUM_STALL_CAUSES; c++) s += stalls[c][i];
+			f += flushes[i];
+			cycles += get_cycles(i);
+		}
+		cout << setw(16) << left << region << right << setw(10) << r << setw(10) << s << setw(9) << f << setw(10) << cycles;
+		print_percent(cycles, total);
+		cout << endl;
+		first = last+1;
+	}
+
+	cout.flags(flags);
+	cout.precision(precision);
+}
+
+/* writes one folded stack per instruction: program;region;block;instruction cycles */
+void sim_profile::write_folded(const char *filename, const string *text, unsigned count, const bool *block_leader, map<unsigned, string> &labels, unsigned base_address){
+
+	ofstream fout(filename, ios::out);
+	if (!fout.is_open()) {
+		cerr << "error: open file " << filename << " failed!" << endl;
+		exit(-1);
+	}
+
+	if (count > size) count = size;
+
+	unsigned leader = 0;
+	for (unsigned i=0; i<count; i++){
+		if (block_leader[i]) leader = i;
+		unsigned cycles = get_cycles(i);
+		if (cycles == 0) continue;
+		fout << "program;" << frame_name(region_of(i, labels)) << ";block_0x" << hex << base_address + (leader<<2);
+		fout << ";0x" << base_address + (i<<2) << "_" << frame_name(text[i]) << " " << dec << cycles << endl;
+	}
+}
@@ -0,0 +1,80 @@
+#ifndef SIM_PROFILE_H_
+#define SIM_PROFILE_H_
+
+#include <string>
+#include <map>
+#include <vector>
+#include <cstring>
+
+using namespace std;
+
+// causes a stall cycle can be attributed to
+typedef enum {STALL_RAW, STALL_LOAD_USE, STALL_MEMORY, STALL_VECTOR, NUM_STALL_CAUSES} stall_cause_t;
+
+/*
+Per-PC hot-spot profiler.
+
+Every counter is indexed by the static instruction number ((PC - base) >> 2),
+so recording an event is a single array increment and the profiler can stay
+enabled on long runs. Aggregation (basic blocks, labels) and output formatting
+only happen when a report is requested.
+*/
+class sim_profile{
+
+	// number of slots, i.e. the largest program that can be profiled
+	unsigned size;
+
+	// instructions that completed write-back
+	unsigned *retired;
+
+	// stall cycles charged to the stalled instruction, by cause
+	unsigned *stalls[NUM_STALL_CAUSES];
+
+	// wrong-path slots squashed because of a taken branch, charged to the branch
+	unsigned *flushes;
+
+public:
+
+	sim_profile(unsigned program_size);
+
+	~sim_profile();
+
+	//clears all the counters
+	void reset();
+
+	//clears the counters of the first "count" instructions (the others must be clear already)
+	void reset(unsigned count);
+
+	//copies the counters of the first "count" instructions to "state"
+	void save(unsigned count, vector<unsigned> &state);
+
+	//restores the counters saved with save (the counters after the first "count" must be clear)
+	void restore(unsigned count, const vector<unsigned> &state);
+
+	//event recording - "idx" is the static instruction number
+	inline void retire(unsigned idx){ if (idx < size) retired[idx]++; }
+
+	inline void stall(unsigned idx, stall_cause_t cause){ if (idx < size) stalls[cause][idx]++; }
+
+	inline void flush(unsigned idx, unsigned slots){ if (idx < size) flushes[idx] += slots; }
+
+	//counter accessors
+	unsigned get_retired(unsigned idx);
+
+	unsigned get_stalls(unsigned idx, stall_cause_t cause);
+
+	unsigned get_flushes(unsigned idx);
+
+	//cycles attributed to the instruction (retire slot + stall cycles + flushed slots)
+	unsigned get_cycles(unsigned idx);
+
+	//prints the annotated program listing followed by the per-block and per-label summaries
+	//"text" holds the assembly text of the "count" instructions, "labels" maps an instruction number to its label
+	void print(const string *text, unsigned count, const bool *block_leader, map<unsigned, string> &labels, unsigned base_address);
+
+	//writes the profile in folded-stack format (one "frame;frame;frame value" line per instruction),
+	//which can be fed to flamegraph.pl and compatible tools
+	void write_folded(const char *filename, const string *text, unsigned count, const bool *block_leader, map<unsigned, string> &labels, unsigned base_address);
+};
+
+#endif /*SIM_PROFILE_H_*/
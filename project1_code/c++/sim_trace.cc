@@ -0,0 +1,114 @@
+#include "sim_trace.h"
+#include <iostream>
+#include <cstring>
+#include <stdlib.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+using namespace std;
+
+/* =============================================================
+
+   TRACE WRITER
+
+   ============================================================= */
+
+trace_writer::trace_writer(){
+	file = NULL;
+	records = 0;
+}
+
+trace_writer::~trace_writer(){
+	close();
+}
+
+void trace_writer::open(const char *filename){
+	close();
+	file = fopen(filename, "wb");
+	if (file == NULL) {
+		cerr << "error: open file " << filename << " failed!" << endl;
+		exit(-1);
+	}
+	// the record count is written by close
+	trace_header_t header = {{'S', 'I', 'M', 'T', 'R', 'A', 'C', 'E'}, TRACE_VERSION, sizeof(trace_record_t), 0};
+	fwrite(&header, sizeof header, 1, file);
+	records = 0;
+}
+
+void trace_writer::flush(){
+	if (buffer.empty()) return;
+	if (fwrite(buffer.data(), sizeof(trace_record_t), buffer.size(), file) != buffer.size()) {
+		cerr << "error: writing the trace failed!" << endl;
+		exit(-1);
+	}
+	records += buffer.size();
+	buffer.clear();
+}
+
+void trace_writer::close(){
+	if (file == NULL) return;
+	flush();
+	trace_header_t header = {{'S', 'I', 'M', 'T', 'R', 'A', 'C', 'E'}, TRACE_VERSION, sizeof(trace_record_t), records};
+	fseek(file, 0, SEEK_SET);
+	fwrite(&header, sizeof header, 1, file);
+	fclose(file);
+	file = NULL;
+}
+
+unsigned long long trace_writer::get_records(){return records + buffer.size();}
+
+/* =============================================================
+
+   TRACE READER
+
+   ============================================================= */
+
+trace_reader::trace_reader(){
+	map = NULL;
+	map_size = 0;
+	records = NULL;
+	count = 0;
+}
+
+trace_reader::~trace_reader(){
+	close();
+}
+
+void trace_reader::open(const char *filename){
+	close();
+	int fd = ::open(filename, O_RDONLY);
+	struct stat st;
+	if (fd < 0 || fstat(fd, &st) < 0) {
+		cerr << "error: open file " << filename << " failed!" << endl;
+		exit(-1);
+	}
+	map_size = st.st_size;
+	if (map_size >= sizeof(trace_header_t)) map = mmap(NULL, map_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	::close(fd);
+	if (map == NULL || map == MAP_FAILED) {
+		cerr << "error: " << filename << " is not a trace file!" << endl;
+		exit(-1);
+	}
+
+	const trace_header_t *header = (const trace_header_t *)map;
+	if (memcmp(header->magic, "SIMTRACE", 8) || header->version != TRACE_VERSION || header->record_size != sizeof(trace_record_t)) {
+		cerr << "error: " << filename << " is not a trace file of this version!" << endl;
+		exit(-1);
+	}
+	if (header->records >= 0xFFFFFFFF || sizeof(trace_header_t) + header->records * sizeof(trace_record_t) > map_size) {
+		cerr << "error: " << filename << " is truncated!" << endl;
+		exit(-1);
+	}
+	records = (const trace_record_t *)(header + 1);
+	count = header->records;
+}
+
+void trace_reader::close(){
+	if (map != NULL) munmap(map, map_size);
+	map = NULL;
+	map_size = 0;
+	records = NULL;
+	count = 0;
+}
@@ -0,0 +1,102 @@
+#ifndef SIM_TRACE_H_
+#define SIM_TRACE_H_
+
+#include <stdio.h>
+#include <stddef.h>
+#include <vector>
+
+using namespace std;
+
+#define TRACE_VERSION 1
+
+// flags in the low bits of the pc of a trace record
+#define TRACE_TAKEN 0x1 // taken branch
+#define TRACE_VALUE 0x2 // the next record holds the value stored (SW to the device region)
+
+/*
+Instruction trace: the path a program took and the data addresses it accessed, recorded by
+trace_observer (see sim_pipe.h) and replayed by the with_replay configurations (see sim_pipe_core::replay_trace).
+
+The file is a header followed by one record per retired instruction, in program order. A
+record holds the address of the instruction, with the TRACE_* flags in its low bits, and
+the data address of loads and stores (the base address of vector memory instructions) or
+the target of branches (0 for the other instructions). A SW to the device region is followed
+by a record whose address field is the value stored.
+*/
+typedef struct{
+	char magic[8]; // "SIMTRACE"
+	unsigned version;
+	unsigned record_size;
+	unsigned long long records;
+} trace_header_t;
+
+typedef struct{
+	unsigned pc;
+	unsigned address;
+} trace_record_t;
+
+// writes a trace file, buffering the records
+class trace_writer{
+
+	FILE *file;
+	vector<trace_record_t> buffer;
+	unsigned long long records;
+
+	//writes the buffered records to the file
+	void flush();
+
+public:
+
+	trace_writer();
+	~trace_writer();
+
+	//creates the trace file "filename" (the previous one, if any, is closed)
+	void open(const char *filename);
+
+	//writes the record count in the header and closes the file
+	void close();
+
+	inline bool is_open(){ return file != NULL; }
+
+	//appends a record
+	inline void add(unsigned pc, unsigned address){
+		buffer.push_back(trace_record_t{pc, address});
+		if (buffer.size() == 4096) flush();
+	}
+
+	//returns the number of records written so far
+	unsigned long long get_records();
+};
+
+// read-only view of a trace file mapped in memory
+class trace_reader{
+
+	void *map;
+	size_t map_size;
+	const trace_record_t *records;
+	unsigned count;
+
+public:
+
+	trace_reader();
+	~trace_reader();
+
+	//maps the trace file "filename" (the previous one, if any, is unmapped)
+	void open(const char *filename);
+
+	//unmaps the trace file
+	void close();
+
+	inline bool is_open(){ return records != NULL; }
+
+	//number of records
+	inline unsigned size(){ return count; }
+
+	//fields of record "i"
+	inline unsigned pc(unsigned i){ return records[i].pc & ~3u; }
+	inline bool taken(unsigned i){ return records[i].pc & TRACE_TAKEN; }
+	inline bool has_value(unsigned i){ return records[i].pc & TRACE_VALUE; }
+	inline unsigned address(unsigned i){ return records[i].address; }
+};
+
+#endif /*SIM_TRACE_H_*/
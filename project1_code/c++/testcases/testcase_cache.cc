@@ -0,0 +1,103 @@
+#include "sim_pipe.h"
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <stdlib.h>
+#include <unistd.h>
+#include <dirent.h>
+
+using namespace std;
+
+/*
+Test case for the result cache: the same job is run three times - the second run is
+a cache hit, and so is the third, whose registers and memory are written in reverse
+order - then with a different initial memory and with a different latency. The state
+digest hashes the output of print_registers and print_profile, which a hit restores.
+A run with a prefetcher is not cached. Last, a job using the devices (copy_dma.asm) is
+run twice: the hit restores the data memory the DMA engine wrote and the console output.
+*/
+
+/* returns a hash of the registers and of the profile, as printed */
+unsigned long long state_digest(sim_pipe *mips){
+	stringstream ss;
+	streambuf *out = cout.rdbuf(ss.rdbuf());
+	mips->print_registers();
+	mips->print_profile();
+	cout.rdbuf(out);
+	sim_hash h;
+	h.add(ss.str());
+	return h.get();
+}
+
+void run(sim_cache &cache, unsigned latency, unsigned first_value, bool reversed=false, bool prefetch=false){
+
+	unsigned i, j;
+
+	// instantiates the sim_pipe with a 1MB data memory
+	sim_pipe *mips = new sim_pipe(1024*1024, latency);
+
+	//loads program in instruction memory at address 0x10000000
+	mips->load_program("asm/loop_sum.asm", 0x10000000);
+
+	//initialize general purpose registers and data memory (the same state, in reverse order if "reversed")
+	for (i=0; i<5; i++) mips->set_gp_register(reversed ? 4-i : i,0);
+	for (i = 0x0, j=first_value; i<0x20; i+=4, j+=1) mips->write_memory(reversed ? 0x1c-i : i, reversed ? first_value+7-(j-first_value) : j);
+	if (prefetch) mips->set_prefetcher(PREFETCH_STRIDE);
+
+	// runs program to completion, unless the result is in the cache
+	bool hit = mips->run(cache);
+
+	cout << (hit ? "hit " : "miss") << ": latency " << latency << ", first value " << first_value << (reversed ? " (reversed)" : "") << (prefetch ? " (prefetcher)" : "");
+	cout << ", cycles " << mips->get_clock_cycles() << ", instructions " << mips->get_instructions_executed() << ", stalls " << mips->get_stalls();
+	cout << ", R3 " << mips->get_gp_register(3) << ", memory digest " << hex << mips->get_memory_digest() << ", state digest " << state_digest(mips) << dec << endl;
+
+	delete mips;
+}
+
+void run_dma(sim_cache &cache){
+
+	sim_pipe *mips = new sim_pipe(1024*1024, 2);
+	mips->set_io_base(0x80000);
+	mips->load_program("asm/copy_dma.asm", 0x10000000);
+	for (unsigned i=0; i<NUM_GP_REGISTERS; i++) mips->set_gp_register(i,0);
+	for (unsigned i=0; i<0x100; i+=4) mips->write_memory(i, i/4 + 1);
+	for (unsigned i=0x2000; i<0x2100; i+=4) mips->write_memory(i, i);
+
+	bool hit = mips->run(cache);
+
+	cout << dec << (hit ? "hit " : "miss") << ": copy_dma.asm, cycles " << mips->get_clock_cycles() << ", R5 " << mips->get_gp_register(5);
+	cout << ", memory digest " << hex << mips->get_memory_digest() << dec << endl;
+	cout << "console: " << mips->get_devices().get_console();
+	mips->print_memory(0x10f8, 0x1108);
+
+	delete mips;
+}
+
+int main(int argc, char **argv){
+
+	// empty cache in a temporary directory
+	char dir[] = "/tmp/sim_cache_XXXXXX";
+	if (mkdtemp(dir) == NULL) return 1;
+	sim_cache *cache = new sim_cache(dir);
+
+	run(*cache, 0, 1);
+	run(*cache, 0, 1);
+	run(*cache, 0, 1, true);
+	run(*cache, 0, 2);
+	run(*cache, 2, 1);
+	run(*cache, 2, 1, false, true);
+	run(*cache, 2, 1, false, true);
+	run_dma(*cache);
+	run_dma(*cache);
+
+	cout << dec << "hits = " << cache->get_hits() << ", misses = " << cache->get_misses() << endl;
+	delete cache;
+
+	// removes the cache
+	DIR *d = opendir(dir);
+	struct dirent *e;
+	while (d && (e = readdir(d)) != NULL)
+		if (e->d_name[0] != '.') unlink((string(dir) + "/" + e->d_name).c_str());
+	if (d) closedir(d);
+	rmdir(dir);
+}
@@ -0,0 +1,59 @@
+#include "sim_pipe.h"
+#include <iostream>
+#include <stdlib.h>
+
+using namespace std;
+
+/*
+Test case for the memory-mapped devices (mapped at 0x80000):
+- a count-down of the timer
+- a 64-word block copy done by a core loop and by the DMA engine, each followed by the same
+  computation, with data memory latency 0 and 2. The programs print their result and the
+  cycles they took on the console.
+*/
+
+void run(const char *program, unsigned latency){
+
+	unsigned i, j;
+
+	// instantiates the sim_pipe with a 1MB data memory
+	sim_pipe *mips = new sim_pipe(1024*1024, latency);
+	mips->set_io_base(0x80000);
+
+	//loads program in instruction memory at address 0x10000000
+	mips->load_program(program, 0x10000000);
+
+	//initialize general purpose registers
+	for (i=0; i<NUM_GP_REGISTERS; i++) mips->set_gp_register(i,0);
+
+	//initialize data memory: block to copy at 0x0, input of the computation at 0x2000
+	for (i = 0x0, j=1; i<0x100; i+=4, j+=1) mips->write_memory(i,j);
+	for (i = 0x2000, j=100; i<0x2100; i+=4, j+=3) mips->write_memory(i,j);
+
+	// runs program to completion
+	mips->run();
+
+	cout << program << ", data memory latency " << latency << endl;
+	cout << "console: " << mips->get_devices().get_console();
+	mips->print_memory(0x1000, 0x1008);
+	mips->print_memory(0x10F8, 0x1100);
+	cout << "Instruction executed = " << dec << mips->get_instructions_executed() << endl;
+	cout << "Clock cycles = " << dec << mips->get_clock_cycles() << endl;
+	cout << "Stall inserted = " << dec << mips->get_stalls() << endl;
+	cout << "DMA words = " << dec << mips->get_devices().get_dma_words();
+	cout << ", port cycles = " << mips->get_devices().get_dma_port_cycles();
+	cout << ", wait cycles = " << mips->get_devices().get_dma_wait_cycles() << endl << endl;
+
+	delete mips;
+}
+
+int main(int argc, char **argv){
+
+	run("asm/io_timer.asm", 0);
+
+	run("asm/copy_loop.asm", 0);
+	run("asm/copy_dma.asm", 0);
+
+	run("asm/copy_loop.asm", 2);
+	run("asm/copy_dma.asm", 2);
+}
@@ -0,0 +1,53 @@
+#include "sim_energy.h"
+#include <iostream>
+#include <iomanip>
+#include <stdlib.h>
+
+using namespace std;
+
+/*
+Test case for the energy model (default energy table):
+- loop_sum.asm on the classic pipeline and on the 8-stage pipeline with forwarding, with
+  the energy of every 25 cycles; the energy observer must not change the timing
+- vec_ops.asm, where the vector instructions operate on 8 elements each
+*/
+
+/* runs the program with the energy observer and prints the report */
+template <class Config>
+void energy(const char *name, const char *filename, unsigned latency, unsigned interval){
+
+	unsigned i;
+
+	sim_pipe_core<energy_observer, Config> *mips = new sim_pipe_core<energy_observer, Config>(1024*1024, latency);
+	mips->get_observer().configure(default_energy_table(), interval);
+	mips->load_program(filename, 0x10000000);
+	for (i=0; i<NUM_GP_REGISTERS; i++) mips->set_gp_register(i,0);
+	for (i=0; i<0x80; i+=4) mips->write_memory(i, i/4 + 1);
+	for (i=0; i<0x20; i+=4) mips->write_memory(0x1000 + i, 100 + i);
+	mips->run();
+
+	// same program without observer
+	sim_pipe_core<null_observer, Config> *reference = new sim_pipe_core<null_observer, Config>(1024*1024, latency);
+	reference->load_program(filename, 0x10000000);
+	for (i=0; i<NUM_GP_REGISTERS; i++) reference->set_gp_register(i,0);
+	for (i=0; i<0x80; i+=4) reference->write_memory(i, i/4 + 1);
+	for (i=0; i<0x20; i+=4) reference->write_memory(0x1000 + i, 100 + i);
+	reference->run();
+
+	cout << name << ", " << filename << ", latency " << latency << endl;
+	cout << "Instruction executed = " << dec << mips->get_instructions_executed() << endl;
+	cout << "Clock cycles = " << dec << mips->get_clock_cycles();
+	cout << (mips->get_clock_cycles() == reference->get_clock_cycles() ? "" : "  TIMING CHANGED") << endl;
+	mips->get_observer().print_report();
+	cout << endl;
+
+	delete reference;
+	delete mips;
+}
+
+int main(int argc, char **argv){
+
+	energy<classic_pipeline>("classic pipeline", "asm/loop_sum.asm", 2, 25);
+	energy<with_forwarding<pipeline_8> >("8-stage pipeline with forwarding", "asm/loop_sum.asm", 2, 25);
+	energy<classic_pipeline>("classic pipeline", "asm/vec_ops.asm", 1, 0);
+}
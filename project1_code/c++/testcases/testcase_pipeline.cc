@@ -0,0 +1,97 @@
+#include "sim_pipe_core.h"
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <stdlib.h>
+
+using namespace std;
+
+/*
+Test case for the pipeline configurations: every program runs on the classic pipeline, on
+pipeline_7 and pipeline_8, and on the three with forwarding. The final registers (general
+purpose and vector) and data memory must be the ones of the classic pipeline; the cycles and
+stalls of each configuration are recorded.
+*/
+
+typedef struct{
+	unsigned cycles, stalls;
+	unsigned long long registers, memory;
+} result_t;
+
+static const char *programs[] = {"asm/loop_sum.asm", "asm/stride_sum.asm", "asm/list_sum.asm", "asm/vec_ops.asm",
+	"asm/vec_add.asm", "asm/vec_add_scalar.asm", "asm/copy_loop.asm", "asm/data_dep1.asm", "asm/no_dep.asm", "asm/loop_bench.asm"};
+#define NUM_PROGRAMS 10
+
+/* runs program "p" with its data on configuration "Config" */
+template <class Config>
+result_t run(unsigned p){
+
+	sim_pipe_core<null_observer, Config> *mips = new sim_pipe_core<null_observer, Config>(1024*1024, 0);
+	mips->load_program(programs[p], 0x10000000);
+	for (unsigned i=0; i<NUM_GP_REGISTERS; i++) mips->set_gp_register(i, 0);
+	for (unsigned i=0; i<0x100; i+=4) mips->write_memory(i, i/4 + 1);
+	for (unsigned i=0x1000; i<0x3000; i+=4) mips->write_memory(i, i/8);
+	string name = programs[p];
+	if (name == "asm/data_dep1.asm" || name == "asm/no_dep.asm")
+		for (unsigned i=0; i<NUM_GP_REGISTERS; i++) mips->set_gp_register(i, 3*i);
+	if (name == "asm/stride_sum.asm") {
+		// 48 words 72 bytes apart
+		mips->set_gp_register(1, 48);
+		mips->set_gp_register(2, 0x1000);
+		mips->set_gp_register(5, 0x100);
+		mips->set_gp_register(6, 72);
+	}
+	if (name == "asm/list_sum.asm") {
+		// 16 nodes (next, value) scattered in 0x1000-0x1100
+		for (unsigned i=0; i<16; i++){
+			unsigned node = 0x1000 + 16*((i*7) % 16);
+			mips->write_memory(node, (i == 15) ? 0 : 0x1000 + 16*(((i+1)*7) % 16));
+			mips->write_memory(node + 4, i);
+		}
+		mips->set_gp_register(1, 0x1000);
+		mips->set_gp_register(5, 0x100);
+	}
+	if (name == "asm/vec_add.asm") {
+		mips->set_gp_register(1, 16);
+		mips->set_gp_register(6, 32);
+	}
+	if (name == "asm/vec_add_scalar.asm") mips->set_gp_register(1, 64);
+	if (name == "asm/loop_bench.asm") mips->set_gp_register(1, 100);
+	mips->run();
+
+	sim_hash registers;
+	for (unsigned i=0; i<NUM_GP_REGISTERS; i++) registers.add((unsigned)mips->get_gp_register(i));
+	for (unsigned i=0; i<NUM_VREGS; i++)
+		for (unsigned e=0; e<MAX_VL; e++) registers.add(mips->get_vector_register(i, e));
+	result_t result = {mips->get_clock_cycles(), mips->get_stalls(), registers.get(), mips->get_memory_digest()};
+	if (mips->get_memory_fault() != UNDEFINED) result.cycles = UNDEFINED;
+	delete mips;
+	return result;
+}
+
+/* runs program "p" on configuration "Config"; prints one row, checking the final state against "classic" */
+template <class Config>
+void check(const char *name, unsigned p, const result_t &classic){
+	result_t result = run<Config>(p);
+	bool same = result.registers == classic.registers && result.memory == classic.memory;
+	cout << setw(22) << left << name << right << setw(8) << result.cycles << setw(8) << result.stalls;
+	cout << (same ? "  same state" : "  MISMATCH") << endl;
+}
+
+int main(int argc, char **argv){
+
+	for (unsigned p=0; p<NUM_PROGRAMS; p++){
+		result_t classic = run<classic_pipeline>(p);
+		cout << programs[p] << ": registers " << hex << setw(16) << setfill('0') << classic.registers;
+		cout << ", memory " << setw(16) << classic.memory << setfill(' ') << dec << endl;
+		cout << setw(22) << left << "configuration" << right << setw(8) << "cycles" << setw(8) << "stalls" << endl;
+		check<classic_pipeline>("classic (5)", p, classic);
+		check<pipeline_7>("pipeline_7", p, classic);
+		check<pipeline_8>("pipeline_8", p, classic);
+		check<with_forwarding<classic_pipeline> >("classic (5) + fwd", p, classic);
+		check<with_forwarding<pipeline_7> >("pipeline_7 + fwd", p, classic);
+		check<with_forwarding<pipeline_8> >("pipeline_8 + fwd", p, classic);
+		cout << endl;
+	}
+	return 0;
+}
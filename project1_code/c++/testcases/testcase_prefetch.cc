@@ -0,0 +1,111 @@
+#include "sim_pipe_core.h"
+#include <iostream>
+#include <iomanip>
+#include <stdlib.h>
+
+using namespace std;
+
+/*
+Test case for the data prefetchers, on the classic pipeline with data memory latency 12:
+- stride_sum.asm summing 64 consecutive words (stride 4 bytes)
+- stride_sum.asm summing 64 words 72 bytes apart
+- list_sum.asm summing a list of 64 nodes in random order
+Each kernel runs without prefetcher and with every prefetcher at two degree/distance
+settings; the sums must not change. The full report of two runs is printed at the end.
+*/
+
+#define WORDS 64
+
+typedef struct{
+	prefetch_kind_t kind;
+	unsigned degree, distance;
+} setting_t;
+
+static const setting_t settings[] = {
+	{PREFETCH_NONE, 1, 1},
+	{PREFETCH_NEXT_LINE, 1, 1}, {PREFETCH_NEXT_LINE, 2, 2},
+	{PREFETCH_STRIDE, 1, 1}, {PREFETCH_STRIDE, 2, 3},
+	{PREFETCH_STREAM, 1, 1}, {PREFETCH_STREAM, 2, 3}
+};
+
+/* loads the kernel: "stride" bytes between the words summed, or a scattered list if 0 - returns the expected sum */
+int setup(sim_pipe_core<null_observer, classic_pipeline> *mips, unsigned stride){
+	int sum = 0;
+	for (unsigned r=0; r<NUM_GP_REGISTERS; r++) mips->set_gp_register(r, 0);
+	mips->set_gp_register(5, 0x100);
+	if (stride) {
+		mips->load_program("asm/stride_sum.asm", 0x10000000);
+		mips->set_gp_register(1, WORDS);
+		mips->set_gp_register(2, 0x1000);
+		mips->set_gp_register(6, stride);
+		for (unsigned i=0; i<WORDS; i++){
+			mips->write_memory(0x1000 + i*stride, i+1);
+			sum += i+1;
+		}
+		return sum;
+	}
+	// list: the nodes (next, value) are 16 bytes apart, linked in a shuffled order
+	unsigned order[WORDS], seed = 12345;
+	for (unsigned i=0; i<WORDS; i++) order[i] = i;
+	for (unsigned i=WORDS-1; i>0; i--){
+		seed = seed * 1103515245 + 12345;
+		unsigned j = (seed >> 16) % (i+1), t = order[i];
+		order[i] = order[j];
+		order[j] = t;
+	}
+	mips->load_program("asm/list_sum.asm", 0x10000000);
+	mips->set_gp_register(1, 0x1000 + 16*order[0]);
+	for (unsigned i=0; i<WORDS; i++){
+		unsigned node = 0x1000 + 16*order[i];
+		mips->write_memory(node, (i == WORDS-1) ? 0 : 0x1000 + 16*order[i+1]);
+		mips->write_memory(node + 4, i+1);
+		sum += i+1;
+	}
+	return sum;
+}
+
+/* runs the kernel with prefetcher "s"; prints one row of the comparison or the full report */
+unsigned run(unsigned stride, const setting_t &s, unsigned baseline, bool report){
+
+	sim_pipe_core<null_observer, classic_pipeline> *mips = new sim_pipe_core<null_observer, classic_pipeline>(64*1024, 12);
+	mips->set_prefetcher(s.kind, s.degree, s.distance);
+	int expected = setup(mips, stride);
+	mips->run();
+
+	sim_prefetcher &pf = mips->get_prefetcher();
+	unsigned cycles = mips->get_clock_cycles();
+	if (report) pf.print_report();
+	else {
+		cout << setw(12) << pf.get_name() << setw(8) << s.degree << setw(10) << s.distance << setw(8) << cycles;
+		cout << setw(9) << fixed << setprecision(2) << (double)(baseline ? baseline : cycles) / cycles;
+		cout << setw(8) << pf.get_issued() << setw(10) << setprecision(1) << 100 * pf.get_accuracy();
+		cout << setw(10) << 100 * pf.get_coverage() << setw(12) << 100 * pf.get_timeliness() << endl;
+	}
+	if (mips->get_gp_register(3) != expected) cout << "WRONG RESULT" << endl;
+
+	delete mips;
+	return cycles;
+}
+
+void compare(const char *name, unsigned stride){
+	cout << name << endl;
+	cout << setw(12) << "prefetcher" << setw(8) << "degree" << setw(10) << "distance" << setw(8) << "cycles" << setw(9) << "speedup";
+	cout << setw(8) << "issued" << setw(10) << "accuracy" << setw(10) << "coverage" << setw(12) << "timeliness" << endl;
+	unsigned baseline = 0;
+	for (unsigned i=0; i<sizeof(settings)/sizeof(settings[0]); i++){
+		unsigned cycles = run(stride, settings[i], baseline, false);
+		if (i == 0) baseline = cycles;
+	}
+	cout << endl;
+}
+
+int main(int argc, char **argv){
+
+	compare("sequential words (stride 4)", 4);
+	compare("stride 72", 72);
+	compare("scattered list", 0);
+
+	run(4, setting_t{PREFETCH_STREAM, 2, 3}, 0, true);
+	cout << endl;
+	run(72, setting_t{PREFETCH_STRIDE, 2, 3}, 0, true);
+}
@@ -0,0 +1,67 @@
+#include "sim_pipe.h"
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <stdlib.h>
+#include <unistd.h>
+
+using namespace std;
+
+/* Test case for the per-PC profiler: a loop with load-use and branch hazards, printed as an
+   annotated listing and in folded-stack format (the input of flame graph tools) */
+
+int main(int argc, char **argv){
+
+	unsigned i, j;
+
+	// instantiates the sim_pipe with a 1MB data memory
+	sim_pipe *mips = new sim_pipe(1024*1024, 0);
+
+	//loads program in instruction memory at address 0x10000000
+	mips->load_program("asm/loop_sum.asm", 0x10000000);
+
+	//initialize general purpose registers
+	for (i=0; i<5; i++) mips->set_gp_register(i,0);
+
+	//initialize data memory
+	for (i = 0x0, j=1; i<0x20; i+=4, j+=1) mips->write_memory(i,j);
+
+	// runs program to completion
+	mips->run(); 
+
+	cout << "PROGRAM TERMINATED\n";
+	cout << "===================" << endl << endl;
+
+	//prints the value of registers and data memory
+	mips->print_registers();
+	mips->print_memory(0x0, 0x24);
+	
+	cout << endl;
+
+	// prints the number of instructions executed and IPC
+	cout << "Instruction executed = " << dec << mips->get_instructions_executed() << endl;
+	cout << "Clock cycles = " << dec << mips->get_clock_cycles() << endl;
+	cout << "Stall inserted = " << dec  << mips->get_stalls() << endl;
+	cout << "IPC = " << dec << mips->get_IPC() << endl << endl;
+
+	// prints the per-PC profile
+	mips->print_profile();
+
+	// writes the folded profile to a temporary file and prints it: one "stack count" line per frame
+	char folded[] = "/tmp/sim_folded_XXXXXX";
+	int fd = mkstemp(folded);
+	if (fd < 0) {
+		cerr << "error: cannot create a temporary file" << endl;
+		return 1;
+	}
+	close(fd);
+	mips->write_folded_profile(folded);
+	ifstream fin(folded);
+	string line;
+	cout << endl << "FOLDED PROFILE" << endl;
+	while (getline(fin, line)) cout << line << endl;
+	fin.close();
+	unlink(folded);
+
+	delete mips;
+}
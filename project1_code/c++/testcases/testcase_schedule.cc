@@ -0,0 +1,109 @@
+#include "sim_pipe_core.h"
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <stdlib.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/wait.h>
+
+using namespace std;
+
+/*
+Test case for the workload generator (bin/gen_workload) and the scheduler (bin/schedule), which
+must be built first ("make testcase_schedule" builds them). A workload with a fixed seed is
+generated and rescheduled for the classic pipeline and for pipeline_8 with forwarding; both
+programs are then run here on that configuration. The final registers and data memory of the
+rescheduled program must be the ones of the original program; the cycles of both and the
+saving are recorded.
+*/
+
+#define MEM_SIZE (1024*1024)
+
+static string dir;
+
+/* runs "argv" (NULL-terminated) with its output discarded; returns its exit status */
+int tool(const char **argv){
+	cout.flush();
+	pid_t pid = fork();
+	if (pid == 0) {
+		int null = open("/dev/null", O_WRONLY);
+		dup2(null, 1);
+		dup2(null, 2);
+		execv(argv[0], (char **)argv);
+		_exit(127);
+	}
+	int status;
+	waitpid(pid, &status, 0);
+	return WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+}
+
+typedef struct{
+	unsigned cycles, stalls, executed;
+	unsigned long long registers, memory;
+} result_t;
+
+/* runs "program" with the memory image of the workload on configuration "Config", as bin/schedule does */
+template <class Config>
+result_t run(const string &program){
+
+	sim_pipe_core<null_observer, Config> *mips = new sim_pipe_core<null_observer, Config>(MEM_SIZE, 0);
+	mips->load_program(program.c_str(), 0x10000000);
+	for (unsigned i=0; i<NUM_GP_REGISTERS; i++) mips->set_gp_register(i, 0);
+	for (unsigned a=0; a<MEM_SIZE; a+=4) mips->write_memory(a, 0);
+	mips->load_memory((dir + "/w.mem").c_str());
+	mips->run();
+
+	sim_hash registers;
+	for (unsigned i=0; i<NUM_GP_REGISTERS; i++) registers.add((unsigned)mips->get_gp_register(i));
+	result_t result = {mips->get_clock_cycles(), mips->get_stalls(), mips->get_instructions_executed(),
+		registers.get(), mips->get_memory_digest()};
+	if (mips->get_memory_fault() != UNDEFINED) result.cycles = UNDEFINED;
+	delete mips;
+	return result;
+}
+
+/* reschedules the workload for "config" and compares the two programs on "Config" */
+template <class Config>
+void check(const char *config){
+	string scheduled = dir + "/w_" + config + ".asm";
+	const char *argv[] = {"bin/schedule", "", "", "--mem", "", "--mem-size", "1048576", "--config", config, NULL};
+	string original = dir + "/w.asm", image = dir + "/w.mem";
+	argv[1] = original.c_str();
+	argv[2] = scheduled.c_str();
+	argv[4] = image.c_str();
+	int status = tool(argv);
+	cout << "schedule --config " << config << ": exit status " << status << endl;
+
+	result_t before = run<Config>(original), after = run<Config>(scheduled);
+	cout << setw(12) << left << "program" << right << setw(8) << "cycles" << setw(8) << "stalls" << setw(10) << "executed" << endl;
+	cout << setw(12) << left << "original" << right << setw(8) << before.cycles << setw(8) << before.stalls << setw(10) << before.executed << endl;
+	cout << setw(12) << left << "scheduled" << right << setw(8) << after.cycles << setw(8) << after.stalls << setw(10) << after.executed << endl;
+	bool same = before.registers == after.registers && before.memory == after.memory;
+	cout << "final state: " << (same ? "same" : "MISMATCH") << endl;
+	cout << "cycle saving: " << (int)(before.cycles - after.cycles) << endl << endl;
+	unlink(scheduled.c_str());
+}
+
+int main(int argc, char **argv){
+
+	char tmp[] = "/tmp/schedule_test_XXXXXX";
+	if (mkdtemp(tmp) == NULL) {
+		cerr << "error: cannot create a temporary directory" << endl;
+		return 1;
+	}
+	dir = tmp;
+
+	string prefix = dir + "/w";
+	const char *generate[] = {"bin/gen_workload", "--out", prefix.c_str(), "--seed", "7", "--trips", "10,20", "--body", "24", NULL};
+	int status = tool(generate);
+	cout << "gen_workload --seed 7 --trips 10,20 --body 24: exit status " << status << endl << endl;
+
+	check<classic_pipeline>("classic");
+	check<with_forwarding<pipeline_8> >("pipeline_8+fwd");
+
+	unlink((dir + "/w.asm").c_str());
+	unlink((dir + "/w.mem").c_str());
+	rmdir(tmp);
+	return 0;
+}
@@ -0,0 +1,211 @@
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+
+using namespace std;
+
+/*
+Test case for the simulation daemon (bin/simd) and its client (bin/simc), which must be built
+first ("make testcase_simd" builds them). A daemon with one worker and a queue of one job gets:
+a job through simc, a program that does not parse, a program without EOP, loads and stores
+outside data memory, a client that sends nothing (timeout) while another one asks for STATS,
+a full queue (BUSY) and a client that goes away during its job. A second daemon caps the
+cycles of a job that never ends.
+*/
+
+static string dir;
+
+/* writes the program "text" in file "name" of the test directory and returns its path */
+string program(const char *name, const char *text){
+	string path = dir + "/" + name;
+	ofstream fout(path.c_str());
+	fout << text;
+	return path;
+}
+
+/* starts bin/simd on "socket" with options "args" (NULL-terminated); returns its pid once it accepts connections */
+pid_t start_daemon(const string &socket, const char **args){
+	const char *argv[32] = {"bin/simd", "--socket", socket.c_str()};
+	unsigned argc = 3;
+	while (*args) argv[argc++] = *args++;
+	argv[argc] = NULL;
+
+	cout.flush();
+	pid_t pid = fork();
+	if (pid == 0) {
+		int null = open("/dev/null", O_WRONLY);
+		dup2(null, 2);
+		execv(argv[0], (char **)argv);
+		_exit(127);
+	}
+	for (unsigned i=0; i<200 && access(socket.c_str(), F_OK) != 0; i++) usleep(10000);
+	return pid;
+}
+
+/* runs bin/simc with options "args" (NULL-terminated) on "socket"; returns its exit status */
+int client(const string &socket, const char **args){
+	const char *argv[32] = {"bin/simc", "--socket", socket.c_str()};
+	unsigned argc = 3;
+	while (*args) argv[argc++] = *args++;
+	argv[argc] = NULL;
+
+	cout.flush();
+	pid_t pid = fork();
+	if (pid == 0) {
+		execv(argv[0], (char **)argv);
+		_exit(127);
+	}
+	int status;
+	waitpid(pid, &status, 0);
+	return WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+}
+
+/* opens a connection to the daemon and sends "request" (nothing if empty) */
+int connect_to(const string &socket, const string &request){
+	int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+	struct sockaddr_un addr;
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	strncpy(addr.sun_path, socket.c_str(), sizeof(addr.sun_path)-1);
+	if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0) {
+		cerr << "error: cannot connect to the daemon" << endl;
+		exit(1);
+	}
+	if (!request.empty()) send(fd, (request + "\n").data(), request.length() + 1, MSG_NOSIGNAL);
+	return fd;
+}
+
+/* reads one reply line (empty when the connection is closed) */
+string read_line(int fd){
+	string line;
+	char c;
+	while (recv(fd, &c, 1, 0) == 1 && c != '\n') line += c;
+	return line;
+}
+
+/* reads the reply up to END or BUSY; the PROGRESS lines are counted, the test directory is printed as <dir> */
+string read_reply(int fd){
+	string reply, line;
+	unsigned progress = 0;
+	do {
+		line = read_line(fd);
+		if (line.compare(0, 9, "PROGRESS ") == 0) progress++;
+		else reply += line + "\n";
+	} while (line != "END" && line != "BUSY" && !line.empty());
+	size_t at;
+	while ((at = reply.find(dir)) != string::npos) reply.replace(at, dir.length(), "<dir>");
+	if (progress) reply = to_string(progress) + " PROGRESS lines\n" + reply;
+	return reply;
+}
+
+/* sends "request" and prints the reply */
+void request(const string &socket, const string &text){
+	int fd = connect_to(socket, text);
+	string reply = read_reply(fd);
+	close(fd);
+	size_t at;
+	string shown = text;
+	while ((at = shown.find(dir)) != string::npos) shown.replace(at, dir.length(), "<dir>");
+	cout << "> " << shown << endl << reply;
+}
+
+/* returns the value of "counter" in the STATS reply */
+unsigned counter(const string &socket, const string &name){
+	int fd = connect_to(socket, "STATS");
+	string reply = read_reply(fd);
+	close(fd);
+	size_t at = reply.find(name + " ");
+	return (at == string::npos) ? 0 : atoi(reply.c_str() + at + name.length() + 1);
+}
+
+/* waits (up to 2s) until "counter" of the STATS reply is "value" */
+void wait_counter(const string &socket, const string &name, unsigned value){
+	for (unsigned i=0; i<200 && counter(socket, name) != value; i++) usleep(10000);
+}
+
+int main(int argc, char **argv){
+
+	char tmp[] = "/tmp/simd_test_XXXXXX";
+	if (mkdtemp(tmp) == NULL) {
+		cerr << "error: cannot create a temporary directory" << endl;
+		return 1;
+	}
+	dir = tmp;
+	string socket = dir + "/simd.sock";
+
+	string ok = program("ok.asm", "ADDI R1 R0 5\nADDI R2 R0 7\nADD R3 R1 R2\nSW R3 0(R0)\nEOP\n");
+	string bad = program("bad.asm", "ADDI R1 R0 5\nFOO R1\nEOP\n");
+	string no_eop = program("no_eop.asm", "ADDI R1 R0 5\nADD R2 R1 R1\n");
+	string load = program("load.asm", "ADDI R1 R0 -16\nLW R2 0(R1)\nEOP\n");
+	string store = program("store.asm", "ADDI R1 R0 1024\nSW R1 8(R1)\nEOP\n");
+	string forever = program("forever.asm", "loop: ADDI R1 R1 1\nJUMP loop\nEOP\n");
+
+	const char *options[] = {"--workers", "1", "--queue", "1", "--mem-size", "1032", "--chunk", "10000", "--timeout", "500", NULL};
+	pid_t daemon = start_daemon(socket, options);
+
+	// a job through the client
+	cout << "> simc ok.asm" << endl;
+	const char *run_ok[] = {ok.c_str(), NULL};
+	int status = client(socket, run_ok);
+	cout << "exit status " << status << endl;
+
+	// jobs that cannot be run
+	request(socket, "RUN " + bad);
+	request(socket, "RUN " + no_eop);
+	request(socket, "RUN " + load);
+	request(socket, "RUN " + store);
+
+	// a client that sends nothing does not delay the others, and gets a timeout
+	int idle = connect_to(socket, "");
+	int fd = connect_to(socket, "STATS");
+	read_reply(fd);
+	close(fd);
+	struct pollfd p = {idle, POLLIN, 0};
+	cout << "STATS answered while a client is idle: " << (poll(&p, 1, 0) == 0 ? "yes" : "no") << endl;
+	cout << "> (nothing)" << endl << read_reply(idle);
+	close(idle);
+
+	// the worker runs a job that never ends and the queue holds another one: a third one is rejected
+	int running = connect_to(socket, "RUN " + forever);
+	cout << "running job: " << read_line(running).substr(0, 8) << endl;
+	int queued = connect_to(socket, "RUN " + ok);
+	wait_counter(socket, "queued", 1);
+	request(socket, "RUN " + ok);
+
+	// the client of the running job goes away: the job is aborted and the worker takes the queued one
+	close(running);
+	cout << "> RUN <dir>/ok.asm (queued)" << endl << read_reply(queued);
+	close(queued);
+	wait_counter(socket, "busy_workers", 0);
+	request(socket, "STATS");
+
+	const char *shutdown[] = {"--shutdown", NULL};
+	cout << "> simc --shutdown" << endl;
+	status = client(socket, shutdown);
+	cout << "exit status " << status << endl;
+	waitpid(daemon, &status, 0);
+	cout << "daemon exit status " << WEXITSTATUS(status) << endl << endl;
+
+	// a job that never ends stops at --max-cycles, or before at its own max cycles
+	const char *capped[] = {"--max-cycles", "100000", NULL};
+	daemon = start_daemon(socket, capped);
+	request(socket, "RUN " + forever);
+	request(socket, "RUN " + forever + " - 5000");
+	request(socket, "RUN " + forever + " - 200000");
+	client(socket, shutdown);
+	waitpid(daemon, &status, 0);
+	cout << "daemon exit status " << WEXITSTATUS(status) << endl;
+
+	string files[] = {ok, bad, no_eop, load, store, forever};
+	for (unsigned i=0; i<6; i++) unlink(files[i].c_str());
+	rmdir(tmp);
+	return 0;
+}
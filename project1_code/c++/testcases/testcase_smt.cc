@@ -0,0 +1,93 @@
+#include "sim_pipe_core.h"
+#include <iostream>
+#include <iomanip>
+#include <stdlib.h>
+
+using namespace std;
+
+/*
+Test case for the hardware threads: every thread sums the values of its own linked list
+(list_sum.asm, a chain of dependent loads) and stores the sum. The lists are run one after
+the other on a single thread, then together on 2 and 4 threads with each fetch policy,
+without and with forwarding and with data memory latency 0 and 2. Every thread must
+compute the same sum as on its own.
+*/
+
+#define NODES 16
+
+static const char *policy_names[] = {"round robin", "switch on stall", "ICOUNT"};
+
+/* list of thread "t": NODES nodes (next, value) scattered in the 4KB at 0x1000*(t+1), sum stored at 0x100+4*t */
+template <class Config>
+void setup(sim_pipe_core<null_observer, Config> *mips, unsigned thread, unsigned list){
+	unsigned base = 0x1000*(list+1);
+	for (unsigned i=0; i<NODES; i++){
+		unsigned node = base + 8*((i*5) % NODES);
+		unsigned next = (i == NODES-1) ? 0 : base + 8*(((i+1)*5) % NODES);
+		mips->write_memory(node, next);
+		mips->write_memory(node + 4, list*100 + i);
+	}
+	for (unsigned r=0; r<NUM_GP_REGISTERS; r++) mips->set_gp_register(thread, r, 0);
+	mips->set_gp_register(thread, 1, base);
+	mips->set_gp_register(thread, 5, 0x100 + 4*list);
+}
+
+/* runs "threads" lists on as many hardware threads; returns the cycles, prints the per-thread statistics if "print" */
+template <class Config>
+unsigned run(unsigned threads, fetch_policy_t policy, unsigned latency, bool print){
+
+	sim_pipe_core<null_observer, Config> *mips = new sim_pipe_core<null_observer, Config>(64*1024, latency);
+	mips->load_program("asm/list_sum.asm", 0x10000000);
+	for (unsigned t=1; t<threads; t++) mips->add_thread("asm/list_sum.asm");
+	mips->set_fetch_policy(policy);
+	for (unsigned t=0; t<threads; t++) setup(mips, t, t);
+
+	mips->run();
+
+	bool correct = true;
+	for (unsigned t=0; t<threads; t++){
+		int expected = t*100*NODES + NODES*(NODES-1)/2;
+		correct = correct && mips->get_gp_register(t, 3) == expected;
+	}
+	if (print) mips->print_thread_statistics();
+	if (!correct) cout << "WRONG RESULT" << endl;
+
+	unsigned cycles = mips->get_clock_cycles();
+	delete mips;
+	return cycles;
+}
+
+template <class Config>
+void compare(const char *name, unsigned latency){
+
+	cout << name << ", data memory latency " << latency << endl;
+
+	// the lists one after the other on one thread
+	unsigned sequential[5] = {0, 0, 0, 0, 0};
+	for (unsigned t=0; t<4; t++) sequential[t+1] = sequential[t] + run<Config>(1, ROUND_ROBIN, latency, false);
+	cout << setfill(' ') << setw(18) << "policy" << setw(10) << "threads" << setw(10) << "cycles" << setw(12) << "sequential" << setw(10) << "speedup" << endl;
+
+	for (unsigned p=0; p<3; p++){
+		for (unsigned threads=2; threads<=4; threads+=2){
+			unsigned cycles = run<Config>(threads, (fetch_policy_t)p, latency, false);
+			cout << setw(18) << policy_names[p] << setw(10) << threads << setw(10) << cycles << setw(12) << sequential[threads];
+			cout << setw(10) << fixed << setprecision(2) << (double)sequential[threads]/cycles << endl;
+		}
+	}
+	cout << endl;
+}
+
+int main(int argc, char **argv){
+
+	// per-thread statistics of the classic pipeline, 4 threads
+	for (unsigned p=0; p<3; p++){
+		run<classic_pipeline>(4, (fetch_policy_t)p, 0, true);
+		cout << endl;
+	}
+
+	compare<classic_pipeline>("classic pipeline", 0);
+	compare<classic_pipeline>("classic pipeline", 2);
+	compare<with_forwarding<classic_pipeline> >("classic pipeline with forwarding", 0);
+	compare<with_forwarding<pipeline_8> >("8-stage pipeline with forwarding", 0);
+	compare<with_forwarding<pipeline_8> >("8-stage pipeline with forwarding", 2);
+}
@@ -0,0 +1,102 @@
+#include "sim_pipe.h"
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <stdlib.h>
+
+using namespace std;
+
+/*
+Test case for the snapshots: the DMA block copy program (data memory latency 2) is run to
+completion with a snapshot every 100 cycles, then brought back to several cycles with seek
+and step_back. The state reached must be the one of a simulation stopped at that cycle.
+The same is done with a memory budget that only fits a few snapshots.
+*/
+
+#define CHECKPOINTS 12
+
+static unsigned checkpoints[CHECKPOINTS] = {0, 1, 57, 99, 100, 101, 250, 613, 614, 999, 1000, 1185};
+
+/* returns the state of the simulator: statistics, registers, data memory and console */
+string state(sim_pipe *mips){
+	stringstream ss;
+	ss << mips->get_clock_cycles() << " " << mips->get_instructions_executed() << " " << mips->get_stalls();
+	for (unsigned i=0; i<NUM_GP_REGISTERS; i++) ss << " " << mips->get_gp_register(i);
+	ss << " " << hex << mips->get_memory_digest() << dec << " " << mips->get_devices().get_console();
+	return ss.str();
+}
+
+sim_pipe *create(){
+
+	unsigned i, j;
+
+	// instantiates the sim_pipe with a 64KB data memory and a latency of 2 clock cycles
+	sim_pipe *mips = new sim_pipe(64*1024, 2);
+	mips->set_io_base(0x80000);
+
+	//loads program in instruction memory at address 0x10000000
+	mips->load_program("asm/copy_dma.asm", 0x10000000);
+
+	//initialize general purpose registers
+	for (i=0; i<NUM_GP_REGISTERS; i++) mips->set_gp_register(i,0);
+
+	//initialize data memory: block to copy at 0x0, input of the computation at 0x2000
+	for (i = 0x0, j=1; i<0x100; i+=4, j+=1) mips->write_memory(i,j);
+	for (i = 0x2000, j=100; i<0x2100; i+=4, j+=3) mips->write_memory(i,j);
+
+	return mips;
+}
+
+void check(sim_pipe *mips, string *expected, unsigned checkpoint, bool reached){
+	bool same = reached && state(mips) == expected[checkpoint];
+	cout << "  cycle " << checkpoints[checkpoint] << ": " << (same ? "ok" : "MISMATCH") << endl;
+}
+
+void test(unsigned long long budget, string *expected){
+
+	sim_pipe *mips = create();
+	mips->set_snapshots(100, budget);
+	mips->run();
+	cout << "run to completion: " << (state(mips) == expected[CHECKPOINTS-1] ? "ok" : "MISMATCH") << endl;
+	if (budget == SNAPSHOT_BUDGET) cout << "snapshots = " << mips->get_snapshot_count() << endl;
+	else cout << "within budget: " << (mips->get_snapshot_memory() <= budget || mips->get_snapshot_count() <= 2 ? "yes" : "no") << endl;
+
+	cout << "seek:" << endl;
+	unsigned order[] = {7, 2, 9, 0, 11, 4, 3, 10, 5, 1, 6, 8};
+	for (unsigned k=0; k<CHECKPOINTS; k++) check(mips, expected, order[k], mips->seek(checkpoints[order[k]]));
+
+	cout << "step_back:" << endl;
+	mips->seek(1000);
+	check(mips, expected, 9, mips->step_back());
+	mips->seek(101);
+	check(mips, expected, 4, mips->step_back());
+	check(mips, expected, 3, mips->step_back());
+	mips->seek(1);
+	check(mips, expected, 0, mips->step_back());
+	cout << "step_back at cycle 0: " << (mips->step_back() ? "moved" : "refused") << endl;
+
+	cout << "seek past the end: " << (mips->seek(5000) ? "reached" : "stopped at cycle ") << mips->get_clock_cycles() << endl << endl;
+
+	delete mips;
+}
+
+int main(int argc, char **argv){
+
+	// reference: a simulation stopped at each checkpoint
+	string expected[CHECKPOINTS];
+	sim_pipe *mips = create();
+	for (unsigned k=0; k<CHECKPOINTS; k++){
+		if (checkpoints[k] > mips->get_clock_cycles()) mips->run(checkpoints[k] - mips->get_clock_cycles());
+		expected[k] = state(mips);
+	}
+	// the last checkpoint is the end of the program
+	mips->run();
+	cout << "program completed in " << mips->get_clock_cycles() << " cycles" << endl << endl;
+	delete mips;
+
+	cout << "default budget" << endl;
+	test(SNAPSHOT_BUDGET, expected);
+
+	cout << "budget of 100KB" << endl;
+	test(100*1024, expected);
+}
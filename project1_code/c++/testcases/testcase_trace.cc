@@ -0,0 +1,139 @@
+#include "sim_pipe_core.h"
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <stdlib.h>
+#include <unistd.h>
+
+using namespace std;
+
+/*
+Test case for the trace replay: the trace of every program is recorded on the classic pipeline
+with data memory latency 0, then replayed on every pipeline configuration with latency 0 and 4
+(and a stride prefetcher at latency 4). A replay must take as many cycles, retire as many
+instructions and stall as many times as executing the program on the same configuration.
+copy_dma.asm polls the DMA engine, so its path depends on the timing: it is only replayed on
+the configuration it was recorded on. The last check seeks back during a replay.
+*/
+
+typedef struct{
+	unsigned cycles, instructions, stalls;
+	string console;
+} result_t;
+
+static const char *programs[] = {"asm/loop_sum.asm", "asm/stride_sum.asm", "asm/list_sum.asm", "asm/vec_ops.asm", "asm/copy_dma.asm"};
+
+/* loads program "p" and its data */
+template <class Observer, class Config>
+void setup(sim_pipe_core<Observer, Config> *mips, unsigned p){
+	mips->set_io_base(0x80000);
+	mips->load_program(programs[p], 0x10000000);
+	for (unsigned i=0; i<NUM_GP_REGISTERS; i++) mips->set_gp_register(i, 0);
+	for (unsigned i=0; i<0x100; i+=4) mips->write_memory(i, i/4 + 1);
+	for (unsigned i=0x1000; i<0x2000; i+=4) mips->write_memory(i, i/8);
+	for (unsigned i=0x2000; i<0x2100; i+=4) mips->write_memory(i, 3*i);
+	if (p == 1) {
+		// 48 words 72 bytes apart
+		mips->set_gp_register(1, 48);
+		mips->set_gp_register(2, 0x1000);
+		mips->set_gp_register(5, 0x100);
+		mips->set_gp_register(6, 72);
+	}
+	if (p == 2) {
+		// 16 nodes (next, value) scattered in 0x1000-0x1100
+		for (unsigned i=0; i<16; i++){
+			unsigned node = 0x1000 + 16*((i*7) % 16);
+			mips->write_memory(node, (i == 15) ? 0 : 0x1000 + 16*(((i+1)*7) % 16));
+			mips->write_memory(node + 4, i);
+		}
+		mips->set_gp_register(1, 0x1000);
+		mips->set_gp_register(5, 0x100);
+	}
+}
+
+/* executes program "p" (recording its trace in "record" if not NULL), or replays the trace "replay" on a with_replay configuration */
+template <class Observer, class Config>
+result_t run(unsigned p, unsigned latency, bool prefetch, const char *record, const char *replay){
+
+	sim_pipe_core<Observer, Config> *mips = new sim_pipe_core<Observer, Config>(1024*1024, latency);
+	setup(mips, p);
+	if (prefetch) mips->set_prefetcher(PREFETCH_STRIDE, 2, 2);
+	if constexpr (Config::replay) mips->replay_trace(replay);
+	if constexpr (is_same<Observer, trace_observer>::value) mips->get_observer().writer.open(record);
+	mips->run();
+	if constexpr (is_same<Observer, trace_observer>::value) mips->get_observer().writer.close();
+
+	result_t result = {mips->get_clock_cycles(), mips->get_instructions_executed(), mips->get_stalls(), mips->get_devices().get_console()};
+	delete mips;
+	return result;
+}
+
+/* executes and replays program "p" on configuration "Config"; prints one row of the comparison */
+template <class Config>
+void compare(const char *name, unsigned p, unsigned latency, bool prefetch, const char *trace){
+	result_t executed = run<null_observer, Config>(p, latency, prefetch, NULL, NULL);
+	result_t replayed = run<null_observer, with_replay<Config> >(p, latency, prefetch, NULL, trace);
+	bool same = executed.cycles == replayed.cycles && executed.instructions == replayed.instructions
+		&& executed.stalls == replayed.stalls && executed.console == replayed.console;
+	cout << setw(22) << left << name << right << setw(8) << latency << setw(10) << (prefetch ? "stride" : "-");
+	cout << setw(10) << executed.cycles << setw(10) << replayed.cycles << setw(8) << replayed.stalls;
+	cout << (same ? "" : "  MISMATCH") << endl;
+}
+
+int main(int argc, char **argv){
+
+	char trace[] = "/tmp/sim_trace_XXXXXX";
+	int fd = mkstemp(trace);
+	if (fd < 0) {
+		cerr << "error: cannot create a temporary file" << endl;
+		return 1;
+	}
+	close(fd);
+
+	for (unsigned p=0; p<5; p++){
+		unsigned latency = (p == 4) ? 2 : 0;
+		result_t recorded = run<trace_observer, classic_pipeline>(p, latency, false, trace, NULL);
+		trace_reader reader;
+		reader.open(trace);
+		cout << programs[p] << ": " << recorded.instructions << " instructions, " << reader.size() << " trace records" << endl;
+		reader.close();
+
+		cout << setw(22) << left << "configuration" << right << setw(8) << "latency" << setw(10) << "prefetch";
+		cout << setw(10) << "executed" << setw(10) << "replayed" << setw(8) << "stalls" << endl;
+		if (p == 4) {
+			compare<classic_pipeline>("classic (5)", p, latency, false, trace);
+			cout << endl;
+			continue;
+		}
+		for (unsigned l=0; l<=4; l+=4){
+			compare<classic_pipeline>("classic (5)", p, l, false, trace);
+			compare<pipeline_7>("pipeline_7", p, l, false, trace);
+			compare<pipeline_8>("pipeline_8", p, l, false, trace);
+			compare<with_forwarding<classic_pipeline> >("classic (5) + fwd", p, l, false, trace);
+			compare<with_forwarding<pipeline_7> >("pipeline_7 + fwd", p, l, false, trace);
+			compare<with_forwarding<pipeline_8> >("pipeline_8 + fwd", p, l, false, trace);
+		}
+		compare<classic_pipeline>("classic (5)", p, 4, true, trace);
+		compare<with_forwarding<pipeline_8> >("pipeline_8 + fwd", p, 4, true, trace);
+		cout << endl;
+	}
+
+	// replay of stride_sum.asm with snapshots: seeking back and running again to the end gives the same cycles
+	run<trace_observer, classic_pipeline>(1, 0, false, trace, NULL);
+	sim_pipe_core<null_observer, with_replay<pipeline_8> > *mips = new sim_pipe_core<null_observer, with_replay<pipeline_8> >(1024*1024, 4);
+	setup(mips, 1);
+	mips->replay_trace(trace);
+	mips->set_snapshots(20);
+	mips->run();
+	unsigned cycles = mips->get_clock_cycles();
+	bool same = true;
+	for (unsigned c=cycles/3; c<cycles; c+=cycles/3){
+		mips->seek(c);
+		mips->run();
+		same = same && mips->get_clock_cycles() == cycles;
+	}
+	cout << "Seek during a replay: " << (same ? "same cycles" : "MISMATCH") << " (" << cycles << ")" << endl;
+	delete mips;
+
+	unlink(trace);
+}
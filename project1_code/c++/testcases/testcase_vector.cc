@@ -0,0 +1,96 @@
+#include "sim_pipe_core.h"
+#include <iostream>
+#include <iomanip>
+#include <stdlib.h>
+
+using namespace std;
+
+/*
+Test case for the vector extension:
+- every vector instruction (strided and unit-stride accesses, element-wise operations,
+  reductions) with vector length 8, 4 lanes and a vector unit latency of 2 cycles
+- c[i] = a[i] + b[i] and the sum of c over 64 elements, scalar loop vs vector loop, for
+  several vector lengths and lane counts, without and with forwarding, and on the 8-stage pipeline
+*/
+
+#define N 64
+
+/* vector instructions: results in the vector registers, R4-R6 and data memory at 0x3000 */
+void vector_ops(){
+
+	unsigned i;
+
+	sim_pipe *mips = new sim_pipe(1024*1024, 1);
+	mips->set_vector_unit(8, 4, 2);
+	mips->load_program("asm/vec_ops.asm", 0x10000000);
+	for (i=0; i<NUM_GP_REGISTERS; i++) mips->set_gp_register(i,0);
+	for (i=0; i<0x80; i+=4) mips->write_memory(i, i/4 + 1);
+	for (i=0; i<0x20; i+=4) mips->write_memory(0x1000 + i, 100 + i);
+
+	mips->run();
+
+	cout << "vector instructions (VL 8, 4 lanes, latency 2)" << endl;
+	mips->print_registers();
+	mips->print_memory(0x3000, 0x3040);
+	cout << "Instruction executed = " << dec << mips->get_instructions_executed() << endl;
+	cout << "Clock cycles = " << dec << mips->get_clock_cycles() << endl;
+	cout << "Stall inserted = " << dec << mips->get_stalls() << endl << endl;
+
+	delete mips;
+}
+
+/* runs vec_add_scalar.asm (length 0) or vec_add.asm; returns the cycles, the digest of the data memory and the sum */
+template <class Config>
+unsigned vector_add(unsigned length, unsigned lanes, unsigned long long &digest, int &sum){
+
+	unsigned i;
+
+	sim_pipe_core<null_observer, Config> *mips = new sim_pipe_core<null_observer, Config>(1024*1024, 0);
+	if (length) mips->set_vector_unit(length, lanes, 2);
+	mips->load_program(length ? "asm/vec_add.asm" : "asm/vec_add_scalar.asm", 0x10000000);
+	for (i=0; i<NUM_GP_REGISTERS; i++) mips->set_gp_register(i,0);
+	mips->set_gp_register(1, length ? N/length : N); // iterations
+	mips->set_gp_register(6, length*4); // bytes per vector
+	for (i=0; i<N; i++){
+		mips->write_memory(4*i, i);
+		mips->write_memory(0x1000 + 4*i, 3*i + 7);
+	}
+
+	mips->run();
+
+	digest = mips->get_memory_digest();
+	sum = mips->get_gp_register(5);
+	unsigned cycles = mips->get_clock_cycles();
+
+	delete mips;
+	return cycles;
+}
+
+template <class Config>
+void speedup(const char *name){
+
+	unsigned long long scalar_digest, digest;
+	int scalar_sum, sum;
+	unsigned scalar = vector_add<Config>(0, 0, scalar_digest, scalar_sum);
+	cout << name << ": scalar loop " << scalar << " cycles, sum " << scalar_sum << endl;
+	cout << setfill(' ') << setw(8) << "VL" << setw(8) << "lanes" << setw(10) << "cycles" << setw(10) << "speedup" << endl;
+
+	// the vector loop must leave the same data memory and the same sum
+	unsigned configs[][2] = {{4, 1}, {4, 4}, {8, 2}, {8, 8}, {16, 4}, {16, 16}};
+	for (unsigned c=0; c<6; c++){
+		unsigned cycles = vector_add<Config>(configs[c][0], configs[c][1], digest, sum);
+		cout << setw(8) << configs[c][0] << setw(8) << configs[c][1] << setw(10) << cycles;
+		cout << setw(10) << fixed << setprecision(2) << (double)scalar/cycles;
+		cout << ((digest == scalar_digest && sum == scalar_sum) ? "" : "  WRONG RESULT") << endl;
+	}
+	cout << endl;
+}
+
+int main(int argc, char **argv){
+
+	vector_ops();
+
+	speedup<classic_pipeline>("classic pipeline");
+	speedup<with_forwarding<classic_pipeline> >("classic pipeline with forwarding");
+	speedup<with_forwarding<pipeline_8> >("8-stage pipeline with forwarding");
+}
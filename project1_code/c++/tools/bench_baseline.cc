@@ -0,0 +1,43 @@
+#include "sim_pipe.h"
+#include <iostream>
+#include <stdlib.h>
+#include <chrono>
+
+using namespace std;
+
+/*
+Baseline of bench_observer: runs the same loop on the simulator as it was before the observer
+policies. It only uses the sim_pipe interface common to both versions, and is built by
+"make bench_baseline BASELINE=<revision>" against the sim_pipe/sim_profile sources of the git
+revision BASELINE, extracted to build/baseline.
+
+	bin/bench_baseline [iterations]
+
+Prints the simulated cycles and the best speed of REPETITIONS runs in Mcycles/s.
+*/
+
+#define REPETITIONS 5
+
+int main(int argc, char **argv){
+
+	unsigned iterations = (argc > 1) ? strtoul(argv[1], NULL, 0) : 1000000;
+	unsigned cycles = 0;
+	double best = 0;
+
+	for (int r=0; r<REPETITIONS; r++){
+		sim_pipe *mips = new sim_pipe(1024, 0);
+		mips->load_program("asm/loop_bench.asm", 0x10000000);
+		for (unsigned i=0; i<NUM_GP_REGISTERS; i++) mips->set_gp_register(i,0);
+		mips->set_gp_register(1, iterations);
+
+		chrono::steady_clock::time_point start = chrono::steady_clock::now();
+		mips->run();
+		double elapsed = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+		if (r == 0 || elapsed < best) best = elapsed;
+		cycles = mips->get_clock_cycles();
+		delete mips;
+	}
+	cout << cycles << " " << cycles/best/1e6 << endl;
+	return 0;
+}
@@ -0,0 +1,93 @@
+#include "sim_pipe_core.h"
+#include <iostream>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <unistd.h>
+#include <chrono>
+
+using namespace std;
+
+/*
+Benchmark of the observer policies: runs the same loop with the simulator without
+observer (sim_pipe) and with an observer that counts every event, and compares sim_pipe with
+the simulator before the observer policies (bin/bench_baseline, see tools/bench_baseline.cc).
+
+Both are built with -O2 by their own rules, the baseline from the git revision BASELINE:
+	make bench_observer bench_baseline BASELINE=<revision>
+	bin/bench_observer [iterations]
+
+The comparison is skipped if bin/bench_baseline was not built.
+*/
+
+// observer that counts the events it receives
+struct counting_observer : public null_observer {
+	unsigned retired, memory, stalls, flushes;
+	counting_observer() : retired(0), memory(0), stalls(0), flushes(0) {}
+	void on_retire(const retire_event_t &e){ retired++; }
+	void on_memory(const memory_event_t &e){ memory++; }
+	void on_stall(const stall_event_t &e){ stalls++; }
+	void on_flush(const flush_event_t &e){ flushes++; }
+};
+
+#define REPETITIONS 5
+
+/* runs asm/loop_bench.asm "iterations" times and returns the best wall-clock time in seconds */
+template <class Observer>
+double bench(unsigned iterations, unsigned &cycles){
+	double best = 0;
+	for (int r=0; r<REPETITIONS; r++){
+		sim_pipe_core<Observer> *mips = new sim_pipe_core<Observer>(1024, 0);
+		mips->load_program("asm/loop_bench.asm", 0x10000000);
+		for (unsigned i=0; i<NUM_GP_REGISTERS; i++) mips->set_gp_register(i,0);
+		mips->set_gp_register(1, iterations);
+
+		chrono::steady_clock::time_point start = chrono::steady_clock::now();
+		mips->run();
+		double elapsed = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+		if (r == 0 || elapsed < best) best = elapsed;
+		cycles = mips->get_clock_cycles();
+		delete mips;
+	}
+	return best;
+}
+
+/* runs bin/bench_baseline for "iterations" loop iterations; returns its speed in Mcycles/s, or 0 if it is not available */
+double bench_baseline(unsigned iterations, unsigned &cycles){
+	if (access("bin/bench_baseline", X_OK)) return 0;
+	FILE *baseline = popen(("bin/bench_baseline " + to_string(iterations)).c_str(), "r");
+	if (baseline == NULL) return 0;
+	double mcycles = 0;
+	if (fscanf(baseline, "%u %lf", &cycles, &mcycles) != 2) mcycles = 0;
+	pclose(baseline);
+	return mcycles;
+}
+
+int main(int argc, char **argv){
+
+	unsigned iterations = (argc > 1) ? strtoul(argv[1], NULL, 0) : 1000000;
+	unsigned cycles_null, cycles_counting;
+
+	double t_null = bench<null_observer>(iterations, cycles_null);
+	double t_counting = bench<counting_observer>(iterations, cycles_counting);
+
+	cout << "Loop iterations = " << dec << iterations << " (best of " << REPETITIONS << " runs)" << endl;
+	cout << "null_observer:     " << cycles_null << " cycles in " << t_null << " s = " << cycles_null/t_null/1e6 << " Mcycles/s" << endl;
+	cout << "counting_observer: " << cycles_counting << " cycles in " << t_counting << " s = " << cycles_counting/t_counting/1e6 << " Mcycles/s" << endl;
+	cout << "Observer overhead = " << 100.0*(t_counting-t_null)/t_null << "%" << endl;
+
+	unsigned cycles_baseline;
+	double mcycles_baseline = bench_baseline(iterations, cycles_baseline);
+	if (mcycles_baseline == 0) cout << "Baseline: bin/bench_baseline not built (make bench_baseline BASELINE=<revision>)" << endl;
+	else {
+		cout << "baseline:          " << cycles_baseline << " cycles, " << mcycles_baseline << " Mcycles/s" << endl;
+		cout << "sim_pipe vs baseline = " << 100.0*(cycles_null/t_null/1e6 - mcycles_baseline)/mcycles_baseline << "%" << endl;
+	}
+
+	if (cycles_null != cycles_counting){
+		cout << "ERROR: the observer changed the simulated cycles!" << endl;
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,88 @@
+#include "sim_energy.h"
+#include <iostream>
+#include <iomanip>
+#include <stdlib.h>
+#include <string.h>
+
+using namespace std;
+
+/*
+Runs a program on the pipeline configurations of sim_pipe.h and several data memory
+latencies, and compares their energy, power and energy-delay product.
+
+	bin/energy [program.asm] [--table FILE] [--latency N] [--interval N] [--report]
+
+Registers R0-R31 are initialized to 0 and the first 1KB of data memory to 0, 1, 2, ...
+--table reads the energies from FILE (see read_energy_table in sim_energy.h), --latency
+runs only data memory latency N (default: 0, 2 and 10), --report prints the breakdown by
+component of every run and --interval the energy of every N cycles.
+*/
+
+static energy_table_t table;
+static unsigned interval = 0;
+static bool report = false;
+
+/* runs the program on configuration "Config" and prints one row of the comparison */
+template <class Config>
+void compare(const char *name, const char *filename, unsigned latency){
+
+	sim_pipe_core<energy_observer, Config> *mips = new sim_pipe_core<energy_observer, Config>(1024*1024, latency);
+	mips->get_observer().configure(table, interval);
+	mips->load_program(filename, 0x10000000);
+	for (unsigned i=0; i<NUM_GP_REGISTERS; i++) mips->set_gp_register(i, 0);
+	for (unsigned i=0; i<1024; i+=4) mips->write_memory(i, i>>2);
+	mips->run();
+
+	energy_observer &obs = mips->get_observer();
+	cout << setw(22) << left << name << right << setw(8) << latency << setw(10) << mips->get_clock_cycles();
+	cout << setw(10) << fixed << setprecision(1) << obs.get_time() << setw(12) << obs.get_energy();
+	cout << setw(12) << setprecision(2) << obs.get_energy() / mips->get_instructions_executed();
+	cout << setw(10) << obs.get_power() << setw(14) << setprecision(0) << obs.get_edp() << endl;
+	if (report) {
+		cout << endl;
+		obs.print_report();
+		cout << endl;
+	}
+
+	delete mips;
+}
+
+int main(int argc, char **argv){
+
+	const char *filename = "asm/loop_sum.asm";
+	unsigned latencies[] = {0, 2, 10}, num_latencies = 3;
+
+	table = default_energy_table();
+	for (int i=1; i<argc; i++){
+		if (!strcmp(argv[i], "--table") && i+1 < argc) read_energy_table(argv[++i], table);
+		else if (!strcmp(argv[i], "--latency") && i+1 < argc) {
+			latencies[0] = strtoul(argv[++i], NULL, 0);
+			num_latencies = 1;
+		}
+		else if (!strcmp(argv[i], "--interval") && i+1 < argc) {
+			interval = strtoul(argv[++i], NULL, 0);
+			report = true;
+		}
+		else if (!strcmp(argv[i], "--report")) report = true;
+		else if (argv[i][0] != '-') filename = argv[i];
+		else {
+			cerr << "usage: " << argv[0] << " [program.asm] [--table FILE] [--latency N] [--interval N] [--report]" << endl;
+			return 1;
+		}
+	}
+
+	cout << "Program: " << filename << endl;
+	cout << setw(22) << left << "configuration" << right << setw(8) << "latency" << setw(10) << "cycles" << setw(10) << "time(ns)";
+	cout << setw(12) << "energy(pJ)" << setw(12) << "pJ/instr" << setw(10) << "power(mW)" << setw(14) << "EDP(pJ*ns)" << endl;
+
+	for (unsigned l=0; l<num_latencies; l++){
+		compare<classic_pipeline>("classic (5)", filename, latencies[l]);
+		compare<pipeline_7>("pipeline_7", filename, latencies[l]);
+		compare<pipeline_8>("pipeline_8", filename, latencies[l]);
+		compare<with_forwarding<classic_pipeline> >("classic (5) + fwd", filename, latencies[l]);
+		compare<with_forwarding<pipeline_7> >("pipeline_7 + fwd", filename, latencies[l]);
+		compare<with_forwarding<pipeline_8> >("pipeline_8 + fwd", filename, latencies[l]);
+	}
+
+	return 0;
+}
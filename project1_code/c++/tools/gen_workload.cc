@@ -0,0 +1,441 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <stdlib.h>
+#include <string.h>
+
+using namespace std;
+
+/*
+Synthetic workload generator: writes a program in the format accepted by
+sim_pipe::load_program (<prefix>.asm) and the matching data memory image
+accepted by sim_pipe::load_memory (<prefix>.mem).
+
+	bin/gen_workload [options]
+
+	--out PREFIX       output files PREFIX.asm and PREFIX.mem (default: workload)
+	--seed N           random seed - the same options and seed give the same files (default: 1)
+	--loops K          number of consecutive loop nests (default: 1)
+	--nest D           nesting depth of each loop nest, 1 to 3 (default: 2)
+	--trips T0,T1,..   trip count of each nesting level, outermost first (default: 100,100)
+	--body N           instructions in the innermost loop body (default: 32)
+	--mix A,I,L,S,B    relative weights of ALU (ADD/SUB/XOR), immediate (ADDI/SUBI),
+	                   LW, SW and conditional branches (default: 40,20,20,10,10)
+	--raw P1,P2,..     probability that a source operand is produced 1, 2, ... instructions
+	                   earlier; the rest are independent (default: 0.3,0.2,0.1)
+	                   When the instruction at the distance drawn writes no scratch register,
+	                   the closest distance that does is used; the requested and achieved
+	                   distributions are printed at the end.
+	--taken P          fraction of taken conditional branches, for --pattern random (default: 0.5)
+	--pattern P        branch outcomes: random, alternate or a T/N string repeated, e.g. TTN (default: random)
+	--skip N           instructions skipped by a taken branch (default: 2)
+	--footprint BYTES  data memory touched by LW/SW (default: 65536)
+	--stride BYTES     distance between consecutive LW/SW addresses (default: 4)
+
+The program does not depend on the initial register values. Each conditional branch
+tests a value loaded from a per-branch outcome table, so the taken bias and the
+pattern are exact. The innermost loop walks the data region with the given stride and
+restarts from its beginning at every entry; its trip count is reduced when needed to
+stay within the footprint.
+
+Register usage: R0 = 0, R1-R3 loop counters, R4 outcome table pointer, R5 data pointer,
+R6 branch condition, R7-R31 operands.
+*/
+
+#define FIRST_SCRATCH 7
+#define NUM_SCRATCH (32-FIRST_SCRATCH)
+#define MAX_NEST 3
+
+typedef enum {K_ALU, K_IMM, K_LOAD, K_STORE, K_BRANCH, NUM_KINDS} kind_t;
+
+/* =============================================================
+
+   HELPER FUNCTIONS
+
+   ============================================================= */
+
+/* splitmix64 - portable, so the output only depends on the seed */
+static unsigned long long rng_state;
+
+static unsigned long long rng_next(){
+	unsigned long long z = (rng_state += 0x9E3779B97F4A7C15ULL);
+	z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+	z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+	return z ^ (z >> 31);
+}
+
+/* uniform in [0,1) */
+static double rng_real(){ return (rng_next() >> 11) * (1.0/9007199254740992.0); }
+
+/* uniform in [0,n) */
+static unsigned rng_int(unsigned n){ return (unsigned)(rng_next() % n); }
+
+/* parses a comma-separated list of numbers */
+static vector<double> parse_list(const char *arg){
+	vector<double> list;
+	stringstream ss(arg);
+	string item;
+	while (getline(ss, item, ',')) list.push_back(atof(item.c_str()));
+	return list;
+}
+
+/* =============================================================
+
+   GENERATOR
+
+   ============================================================= */
+
+struct options_t{
+	string out;
+	unsigned long long seed;
+	unsigned loops, nest, body, skip, footprint, stride;
+	vector<double> trips, mix, raw;
+	double taken;
+	string pattern;
+};
+
+struct line_t{
+	string label;
+	string text;
+};
+
+class generator{
+
+	options_t &opt;
+
+	vector<line_t> program;
+	string pending_label; // label of the next instruction emitted
+
+	// register written by each instruction of the current body (-1 if none)
+	vector<int> writers;
+
+	// number of LW/SW emitted in the current body
+	unsigned mem_ops;
+
+	// outcome tables: one per conditional branch, opt.trips.back() words each
+	vector<vector<unsigned> > tables;
+
+	// address of the outcome tables in data memory
+	unsigned table_base;
+
+	unsigned label_nr;
+
+	// source operands per RAW distance (index 0: independent), as drawn and as generated
+	vector<unsigned> raw_requested, raw_achieved;
+
+public:
+
+	unsigned long long dynamic_instructions;
+
+	generator(options_t &o) : opt(o), mem_ops(0), label_nr(0), raw_requested(o.raw.size()+1), raw_achieved(o.raw.size()+1), dynamic_instructions(0) {
+		table_base = (opt.footprint + 4095) & ~4095u;
+	}
+
+	/* appends an instruction to the program */
+	void emit(const string &text, int dest = -1){
+		line_t line;
+		line.label = pending_label;
+		line.text = text;
+		program.push_back(line);
+		pending_label.clear();
+		writers.push_back(dest);
+	}
+
+	string new_label(const string &prefix){
+		return prefix + to_string(label_nr++);
+	}
+
+	/* distance to the closest instruction of the current body writing "reg" (0 if none) */
+	unsigned raw_distance(unsigned reg){
+		for (unsigned d=1; d<=writers.size(); d++)
+			if (writers[writers.size()-d] == (int)reg) return d;
+		return 0;
+	}
+
+	/* picks a source register according to the RAW distance distribution */
+	unsigned pick_source(){
+		unsigned reg = pick_register();
+		unsigned d = raw_distance(reg);
+		raw_achieved[(d >= 1 && d <= opt.raw.size()) ? d : 0]++;
+		return reg;
+	}
+
+	/* picks the source register for pick_source: the distance drawn is replaced by the closest one
+	   (the shorter on a tie) whose writer writes a scratch register not rewritten since */
+	unsigned pick_register(){
+		double u = rng_real();
+		unsigned window = opt.raw.size();
+		for (unsigned d=1; d<=window; d++){
+			if (u < opt.raw[d-1]){
+				raw_requested[d]++;
+				for (unsigned delta=0; delta<window; delta++){
+					if (d > delta && valid_writer(d-delta)) return writers[writers.size()-(d-delta)];
+					if (d+delta <= window && valid_writer(d+delta)) return writers[writers.size()-(d+delta)];
+				}
+				break;
+			}
+			u -= opt.raw[d-1];
+			if (d == window) raw_requested[0]++;
+		}
+		if (window == 0) raw_requested[0]++;
+		// independent operand: avoid the registers written within the distance window
+		unsigned reg = FIRST_SCRATCH + rng_int(NUM_SCRATCH);
+		for (int attempt=0; attempt<8; attempt++){
+			unsigned d = raw_distance(reg);
+			if (d == 0 || d > window) break;
+			reg = FIRST_SCRATCH + rng_int(NUM_SCRATCH);
+		}
+		return reg;
+	}
+
+	/* true if the instruction "d" positions back writes a scratch register that is read at distance "d" */
+	bool valid_writer(unsigned d){
+		if (writers.size() < d || writers[writers.size()-d] < FIRST_SCRATCH) return false;
+		return raw_distance(writers[writers.size()-d]) == d;
+	}
+
+	unsigned pick_dest(){ return FIRST_SCRATCH + rng_int(NUM_SCRATCH); }
+
+	/* picks the kind of the next instruction according to the mix */
+	kind_t pick_kind(){
+		double total = 0;
+		for (int k=0; k<NUM_KINDS; k++) total += opt.mix[k];
+		double u = rng_real() * total;
+		for (int k=0; k<NUM_KINDS; k++){
+			if (u < opt.mix[k]) return (kind_t)k;
+			u -= opt.mix[k];
+		}
+		return K_ALU;
+	}
+
+	/* emits one non-branch instruction of kind "kind" */
+	void emit_simple(kind_t kind){
+		static const char *alu_ops[] = {"ADD", "SUB", "XOR"};
+		static const char *imm_ops[] = {"ADDI", "SUBI"};
+		unsigned offset = (mem_ops * opt.stride) % opt.footprint;
+		unsigned src1, src2, dest;
+		switch(kind){
+			case K_IMM:
+				src1 = pick_source();
+				dest = pick_dest();
+				emit(string(imm_ops[rng_int(2)]) + "\tR" + to_string(dest) + " R" + to_string(src1) + " " + to_string(1 + rng_int(100)), dest);
+				break;
+			case K_LOAD:
+				dest = pick_dest();
+				emit("LW\tR" + to_string(dest) + " " + to_string(offset) + "(R5)", dest);
+				mem_ops++;
+				break;
+			case K_STORE:
+				src2 = pick_source();
+				emit("SW\tR" + to_string(src2) + " " + to_string(offset) + "(R5)");
+				mem_ops++;
+				break;
+			default:
+				src1 = pick_source();
+				src2 = pick_source();
+				dest = pick_dest();
+				emit(string(alu_ops[rng_int(3)]) + "\tR" + to_string(dest) + " R" + to_string(src1) + " R" + to_string(src2), dest);
+				break;
+		}
+	}
+
+	/* emits a non-branch instruction following the mix */
+	void emit_random(){
+		kind_t kind;
+		do kind = pick_kind(); while (kind == K_BRANCH && opt.mix[K_ALU] + opt.mix[K_IMM] + opt.mix[K_LOAD] + opt.mix[K_STORE] > 0);
+		if (kind == K_BRANCH) kind = K_ALU;
+		emit_simple(kind);
+	}
+
+	/* generates the innermost loop body; "trips" is the length of the outcome tables */
+	void generate_body(unsigned trips){
+		unsigned count = 0;
+		while (count < opt.body){
+			kind_t kind = pick_kind();
+			// a conditional branch needs room for its condition load, 2 lead instructions and the skipped ones
+			if (kind == K_BRANCH && opt.body - count >= opt.skip + 4){
+				unsigned site = tables.size();
+				tables.push_back(vector<unsigned>(trips));
+				for (unsigned i=0; i<trips; i++){
+					bool taken;
+					if (opt.pattern == "random") taken = rng_real() < opt.taken;
+					else if (opt.pattern == "alternate") taken = (i % 2 == 0);
+					else taken = (opt.pattern[i % opt.pattern.length()] == 'T');
+					tables[site][i] = taken;
+				}
+				string target = new_label("skip");
+				emit("LW\tR6 " + to_string(table_base + site*trips*4) + "(R4)");
+				emit_random();
+				emit_random();
+				emit("BNEZ\tR6 " + target);
+				for (unsigned i=0; i<opt.skip; i++) emit_random();
+				pending_label = target;
+				count += opt.skip + 4;
+			} else {
+				if (kind == K_BRANCH) kind = K_ALU;
+				emit_simple(kind);
+				count++;
+			}
+		}
+	}
+
+	/* generates one loop nest */
+	void generate_nest(){
+		unsigned depth = opt.nest;
+		vector<unsigned> trips(depth);
+		for (unsigned l=0; l<depth; l++) trips[l] = (l < opt.trips.size()) ? (unsigned)opt.trips[l] : 1;
+
+		vector<string> heads(depth);
+		for (unsigned l=0; l<depth; l++) heads[l] = new_label("loop");
+
+		// counter initializations - the body of level l starts right after the initialization of its counter
+		for (unsigned l=0; l<depth; l++){
+			emit("ADDI\tR" + to_string(1+l) + " R0 " + to_string(trips[l]), 1+l);
+			if (l+1 < depth) pending_label = heads[l];
+		}
+		emit("ADDI\tR4 R0 0");
+		emit("ADDI\tR5 R0 0");
+
+		// innermost body
+		pending_label = heads[depth-1];
+		unsigned first = program.size();
+		writers.clear();
+		mem_ops = 0;
+		unsigned inner = trips[depth-1];
+		generate_body(inner);
+		emit("ADDI\tR4 R4 4");
+		if (mem_ops && opt.stride){
+			emit("ADDI\tR5 R5 " + to_string(mem_ops*opt.stride));
+			// stay within the footprint
+			unsigned max_trips = opt.footprint / (mem_ops*opt.stride);
+			if (max_trips == 0) max_trips = 1;
+			if (inner > max_trips){
+				cerr << "note: innermost trip count reduced from " << inner << " to " << max_trips << " to stay within the footprint" << endl;
+				inner = max_trips;
+				// the counter initialization of the innermost level
+				program[first-3].text = "ADDI\tR" + to_string(depth) + " R0 " + to_string(inner);
+			}
+		}
+		unsigned body_size = program.size() - first;
+
+		// loop closing branches, innermost first
+		unsigned long long iterations = 1;
+		for (unsigned l=0; l<depth; l++) iterations *= (l == depth-1) ? inner : trips[l];
+		dynamic_instructions += iterations * (body_size + 2);
+		for (int l=depth-1; l>=0; l--){
+			emit("SUBI\tR" + to_string(1+l) + " R" + to_string(1+l) + " 1", 1+l);
+			emit("BNEZ\tR" + to_string(1+l) + " " + heads[l]);
+		}
+	}
+
+	void generate(){
+		// registers do not depend on the initial state of the simulator
+		emit("XOR\tR0 R0 R0", 0);
+		for (unsigned r=FIRST_SCRATCH; r<32; r++) emit("ADDI\tR" + to_string(r) + " R0 " + to_string(rng_int(1000)), r);
+		for (unsigned k=0; k<opt.loops; k++) generate_nest();
+		emit("EOP");
+	}
+
+	/* writes the program and the data memory image */
+	void write(){
+		string asm_name = opt.out + ".asm";
+		ofstream fasm(asm_name.c_str(), ios::out);
+		if (!fasm.is_open()) {
+			cerr << "error: open file " << asm_name << " failed!" << endl;
+			exit(-1);
+		}
+		for (unsigned i=0; i<program.size(); i++){
+			if (!program[i].label.empty()) fasm << program[i].label << ":\t";
+			fasm << program[i].text << endl;
+		}
+
+		string mem_name = opt.out + ".mem";
+		ofstream fmem(mem_name.c_str(), ios::out);
+		if (!fmem.is_open()) {
+			cerr << "error: open file " << mem_name << " failed!" << endl;
+			exit(-1);
+		}
+		unsigned words = (opt.footprint + 3) / 4;
+		fmem << "# data region" << endl;
+		for (unsigned i=0; i<words; i++) fmem << "0x" << hex << i*4 << " 0x" << (unsigned)rng_next() << endl;
+		fmem << "# branch outcome tables" << endl;
+		unsigned address = table_base;
+		for (unsigned t=0; t<tables.size(); t++)
+			for (unsigned i=0; i<tables[t].size(); i++, address+=4)
+				fmem << "0x" << hex << address << " " << dec << tables[t][i] << endl;
+
+		cerr << asm_name << ": " << program.size() << " instructions, ~" << dynamic_instructions << " executed" << endl;
+		cerr << mem_name << ": data memory of at least " << address << " bytes" << endl;
+
+		// static RAW distances of the source operands of the loop bodies
+		unsigned sources = 0;
+		for (unsigned d=0; d<raw_achieved.size(); d++) sources += raw_achieved[d];
+		if (sources == 0) return;
+		cerr << "RAW distance (fraction of " << dec << sources << " source operands):" << endl;
+		cerr << "  distance   requested   achieved" << endl;
+		for (unsigned d=0; d<raw_achieved.size(); d++){
+			unsigned i = (d+1) % raw_achieved.size(); // independent operands last
+			cerr << "  " << setw(8) << left << (i ? to_string(i) : string("indep.")) << right << fixed << setprecision(3);
+			cerr << setw(12) << (double)raw_requested[i]/sources << setw(11) << (double)raw_achieved[i]/sources << endl;
+		}
+	}
+
+};
+
+int main(int argc, char **argv){
+
+	options_t opt;
+	opt.out = "workload";
+	opt.seed = 1;
+	opt.loops = 1;
+	opt.nest = 2;
+	opt.body = 32;
+	opt.skip = 2;
+	opt.footprint = 65536;
+	opt.stride = 4;
+	opt.trips = parse_list("100,100");
+	opt.mix = parse_list("40,20,20,10,10");
+	opt.raw = parse_list("0.3,0.2,0.1");
+	opt.taken = 0.5;
+	opt.pattern = "random";
+
+	for (int i=1; i<argc; i++){
+		if (i+1 == argc) {
+			cerr << "error: missing value for " << argv[i] << endl;
+			return 1;
+		}
+		const char *arg = argv[i++];
+		if (!strcmp(arg, "--out")) opt.out = argv[i];
+		else if (!strcmp(arg, "--seed")) opt.seed = strtoull(argv[i], NULL, 0);
+		else if (!strcmp(arg, "--loops")) opt.loops = atoi(argv[i]);
+		else if (!strcmp(arg, "--nest")) opt.nest = atoi(argv[i]);
+		else if (!strcmp(arg, "--trips")) opt.trips = parse_list(argv[i]);
+		else if (!strcmp(arg, "--body")) opt.body = atoi(argv[i]);
+		else if (!strcmp(arg, "--mix")) opt.mix = parse_list(argv[i]);
+		else if (!strcmp(arg, "--raw")) opt.raw = parse_list(argv[i]);
+		else if (!strcmp(arg, "--taken")) opt.taken = atof(argv[i]);
+		else if (!strcmp(arg, "--pattern")) opt.pattern = argv[i];
+		else if (!strcmp(arg, "--skip")) opt.skip = atoi(argv[i]);
+		else if (!strcmp(arg, "--footprint")) opt.footprint = strtoul(argv[i], NULL, 0);
+		else if (!strcmp(arg, "--stride")) opt.stride = strtoul(argv[i], NULL, 0);
+		else {
+			cerr << "error: unknown option " << arg << endl;
+			return 1;
+		}
+	}
+
+	if (opt.nest < 1 || opt.nest > MAX_NEST || opt.mix.size() != NUM_KINDS || opt.footprint < 4 || opt.pattern.empty()) {
+		cerr << "error: invalid options (see the comment at the top of gen_workload.cc)" << endl;
+		return 1;
+	}
+	for (unsigned l=0; l<opt.trips.size(); l++) if (opt.trips[l] < 1) opt.trips[l] = 1;
+
+	rng_state = opt.seed;
+	generator gen(opt);
+	gen.generate();
+	gen.write();
+	return 0;
+}
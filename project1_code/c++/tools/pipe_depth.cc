@@ -0,0 +1,78 @@
+#include "sim_pipe_core.h"
+#include <iostream>
+#include <iomanip>
+#include <stdlib.h>
+
+using namespace std;
+
+/*
+Runs a program on the pipeline configurations of sim_pipe.h and reports how the
+depth and the forwarding network change the branch and load-use penalties.
+
+	bin/pipe_depth [program.asm]
+
+Registers R0-R31 are initialized to 0 and the first 1KB of data memory to 0, 1, 2, ...
+*/
+
+// observer that counts stall episodes (consecutive stall cycles of the same instruction) and taken branches
+struct penalty_observer : public null_observer {
+	unsigned episodes[NUM_STALL_CAUSES];
+	unsigned cycles[NUM_STALL_CAUSES];
+	unsigned last_cycle, last_pc;
+	unsigned branches, flushed;
+
+	penalty_observer() : last_cycle(UNDEFINED), last_pc(UNDEFINED), branches(0), flushed(0) {
+		for (int c=0; c<NUM_STALL_CAUSES; c++) episodes[c] = cycles[c] = 0;
+	}
+	void on_stall(const stall_event_t &e){
+		if (e.cycle != last_cycle+1 || e.pc != last_pc) episodes[e.cause]++;
+		cycles[e.cause]++;
+		last_cycle = e.cycle;
+		last_pc = e.pc;
+	}
+	void on_flush(const flush_event_t &e){ branches++; flushed += e.slots; }
+};
+
+/* runs the program on configuration "Config" and prints one row of the report */
+template <class Config>
+void report(const char *name, const char *filename){
+
+	sim_pipe_core<penalty_observer, Config> *mips = new sim_pipe_core<penalty_observer, Config>(1024*1024, 0);
+	mips->load_program(filename, 0x10000000);
+	for (unsigned i=0; i<NUM_GP_REGISTERS; i++) mips->set_gp_register(i, 0);
+	for (unsigned i=0; i<1024; i+=4) mips->write_memory(i, i>>2);
+	mips->run();
+
+	penalty_observer &obs = mips->get_observer();
+
+	// checksum of the final registers - must be the same for every configuration
+	unsigned checksum = 0;
+	for (unsigned i=0; i<NUM_GP_REGISTERS; i++) checksum = checksum*31 + mips->get_gp_register(i);
+
+	cout << setw(22) << left << name << right << setw(6) << sim_pipe_core<penalty_observer, Config>::DEPTH;
+	cout << setw(10) << mips->get_clock_cycles() << setw(8) << fixed << setprecision(3) << mips->get_IPC();
+	cout << setw(8) << obs.cycles[STALL_RAW] << setw(10) << obs.cycles[STALL_LOAD_USE];
+	cout << setw(10) << setprecision(2) << (obs.episodes[STALL_LOAD_USE] ? (double)obs.cycles[STALL_LOAD_USE]/obs.episodes[STALL_LOAD_USE] : 0.0);
+	cout << setw(9) << obs.branches << setw(10) << (obs.branches ? (double)obs.flushed/obs.branches : 0.0);
+	cout << "  " << hex << setw(8) << setfill('0') << checksum << setfill(' ') << dec << endl;
+
+	delete mips;
+}
+
+int main(int argc, char **argv){
+
+	const char *filename = (argc > 1) ? argv[1] : "asm/loop_sum.asm";
+
+	cout << "Program: " << filename << endl;
+	cout << setw(22) << left << "configuration" << right << setw(6) << "depth" << setw(10) << "cycles" << setw(8) << "IPC";
+	cout << setw(8) << "RAW" << setw(10) << "LOAD-USE" << setw(10) << "LU/event" << setw(9) << "branches" << setw(10) << "penalty" << "  regs" << endl;
+
+	report<classic_pipeline>("classic (5)", filename);
+	report<pipeline_7>("pipeline_7", filename);
+	report<pipeline_8>("pipeline_8", filename);
+	report<with_forwarding<classic_pipeline> >("classic (5) + fwd", filename);
+	report<with_forwarding<pipeline_7> >("pipeline_7 + fwd", filename);
+	report<with_forwarding<pipeline_8> >("pipeline_8 + fwd", filename);
+
+	return 0;
+}
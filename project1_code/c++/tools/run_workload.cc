@@ -0,0 +1,125 @@
+#include "sim_pipe.h"
+#include <iostream>
+#include <stdlib.h>
+#include <string.h>
+
+using namespace std;
+
+/*
+Runs a program (e.g. one written by gen_workload) to completion and prints the statistics.
+
+	bin/run_workload program.asm [memory.mem] [--mem-size BYTES] [--latency N] [--vector VL LANES LATENCY] [--prefetch next|stride|stream DEGREE DISTANCE] [--threads N [--policy rr|sos|icount]] [--profile] [--folded FILE] [--cache DIR]
+
+Registers R0-R31 are initialized to 0 and the data memory (4MB by default) to 0xFF before
+the memory image, if any, is loaded. --latency sets the data memory latency (default: 0) and
+--vector configures the vector unit (default: 8 4 2). --prefetch puts a next-line, stride or
+stream prefetcher in front of the data memory and prints its statistics.
+--threads runs N copies of the program on as many hardware threads (they share the data
+memory), fetched round robin, switching on stalls or ICOUNT, and prints the per-thread statistics.
+--profile prints the per-PC profile and --folded writes it in folded-stack format.
+--cache reuses the result of an identical earlier run stored in DIR (the profile is not
+available then).
+*/
+
+int main(int argc, char **argv){
+
+	const char *program = NULL, *image = NULL, *folded = NULL, *cache_dir = NULL;
+	unsigned mem_size = 4*1024*1024;
+	unsigned latency = 0;
+	unsigned vector_length = 8, vector_lanes = 4, vector_latency = 2;
+	prefetch_kind_t prefetcher = PREFETCH_NONE;
+	unsigned prefetch_degree = 1, prefetch_distance = 1;
+	unsigned threads = 1;
+	fetch_policy_t policy = ROUND_ROBIN;
+	bool profile = false;
+
+	for (int i=1; i<argc; i++){
+		if (!strcmp(argv[i], "--profile")) profile = true;
+		else if (!strcmp(argv[i], "--folded") && i+1 < argc) folded = argv[++i];
+		else if (!strcmp(argv[i], "--mem-size") && i+1 < argc) mem_size = strtoul(argv[++i], NULL, 0);
+		else if (!strcmp(argv[i], "--cache") && i+1 < argc) cache_dir = argv[++i];
+		else if (!strcmp(argv[i], "--threads") && i+1 < argc) threads = strtoul(argv[++i], NULL, 0);
+		else if (!strcmp(argv[i], "--policy") && i+1 < argc) {
+			i++;
+			if (!strcmp(argv[i], "rr")) policy = ROUND_ROBIN;
+			else if (!strcmp(argv[i], "sos")) policy = SWITCH_ON_STALL;
+			else if (!strcmp(argv[i], "icount")) policy = ICOUNT;
+			else {
+				cerr << "error: unknown fetch policy " << argv[i] << endl;
+				return 1;
+			}
+		}
+		else if (!strcmp(argv[i], "--latency") && i+1 < argc) latency = strtoul(argv[++i], NULL, 0);
+		else if (!strcmp(argv[i], "--prefetch") && i+3 < argc) {
+			i++;
+			if (!strcmp(argv[i], "next")) prefetcher = PREFETCH_NEXT_LINE;
+			else if (!strcmp(argv[i], "stride")) prefetcher = PREFETCH_STRIDE;
+			else if (!strcmp(argv[i], "stream")) prefetcher = PREFETCH_STREAM;
+			else {
+				cerr << "error: unknown prefetcher " << argv[i] << endl;
+				return 1;
+			}
+			prefetch_degree = strtoul(argv[++i], NULL, 0);
+			prefetch_distance = strtoul(argv[++i], NULL, 0);
+		}
+		else if (!strcmp(argv[i], "--vector") && i+3 < argc) {
+			vector_length = strtoul(argv[++i], NULL, 0);
+			vector_lanes = strtoul(argv[++i], NULL, 0);
+			vector_latency = strtoul(argv[++i], NULL, 0);
+		}
+		else if (program == NULL) program = argv[i];
+		else if (image == NULL) image = argv[i];
+		else {
+			cerr << "error: unexpected argument " << argv[i] << endl;
+			return 1;
+		}
+	}
+	if (program == NULL) {
+		cerr << "usage: " << argv[0] << " program.asm [memory.mem] [--mem-size BYTES] [--latency N] [--vector VL LANES LATENCY] [--prefetch next|stride|stream DEGREE DISTANCE] [--threads N [--policy rr|sos|icount]] [--profile] [--folded FILE] [--cache DIR]" << endl;
+		return 1;
+	}
+	if (threads < 1 || threads > MAX_THREADS) {
+		cerr << "error: --threads must be between 1 and " << MAX_THREADS << endl;
+		return 1;
+	}
+
+	sim_pipe *mips = new sim_pipe(mem_size, latency);
+	mips->set_vector_unit(vector_length, vector_lanes, vector_latency);
+	mips->set_prefetcher(prefetcher, prefetch_degree, prefetch_distance);
+	mips->load_program(program, 0x10000000);
+	for (unsigned t=1; t<threads; t++) mips->add_thread(program);
+	mips->set_fetch_policy(policy);
+	for (unsigned t=0; t<threads; t++)
+		for (unsigned i=0; i<NUM_GP_REGISTERS; i++) mips->set_gp_register(t, i, 0);
+	if (image) mips->load_memory(image);
+
+	bool cached = false;
+	if (cache_dir) {
+		sim_cache cache(cache_dir);
+		cached = mips->run(cache);
+	} else mips->run();
+
+	if (cached) cout << "Result from the cache" << endl;
+	cout << "Instruction executed = " << dec << mips->get_instructions_executed() << endl;
+	cout << "Clock cycles = " << dec << mips->get_clock_cycles() << endl;
+	cout << "IPC = " << dec << mips->get_IPC() << endl;
+	cout << "Stalls = " << dec << mips->get_stalls() << endl;
+	cout << "Memory digest = " << hex << mips->get_memory_digest() << dec << endl;
+	if (threads > 1) {
+		cout << endl;
+		mips->print_thread_statistics();
+	}
+	if (prefetcher != PREFETCH_NONE && !cached) {
+		cout << endl;
+		mips->get_prefetcher().print_report();
+	}
+
+	if (profile && !cached) {
+		cout << endl;
+		mips->print_profile();
+	}
+	if (folded && !cached) mips->write_folded_profile(folded);
+
+	delete mips;
+	return 0;
+}
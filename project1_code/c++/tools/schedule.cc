@@ -0,0 +1,374 @@
+#include "sim_pipe_core.h"
+#include <iostream>
+#include <fstream>
+#include <iomanip>
+#include <vector>
+#include <stdlib.h>
+#include <string.h>
+
+using namespace std;
+
+/*
+Stall-minimizing instruction scheduler.
+
+	bin/schedule program.asm scheduled.asm [--mem memory.mem] [--mem-size BYTES] [--config NAME]
+
+Reorders the instructions of each basic block of "program.asm" to hide the RAW and
+load-use latencies of pipeline configuration NAME (classic, pipeline_7 or pipeline_8,
+optionally followed by +fwd, e.g. pipeline_8+fwd; default: classic), writes the result
+to "scheduled.asm", then runs both programs and reports the predicted and the measured
+stall savings.
+
+Hazard model (the one of instruction_decode): an instruction passes the RAW check in ID
+once the nearest producer of each of its sources has reached latch
+	L_MEM_WB+1 (no forwarding; i.e. written back)
+	L_EXE_MEM  (forwarding, ALU producer)
+	L_MEM_WB   (forwarding, LW/VLW/VLWS producer)
+so it can issue at the earliest producer_latency() cycles after its producer issued.
+The cycles vector instructions hold EX and MEM are not modeled.
+
+Within a block the dependency DAG keeps RAW, WAR and WAW register dependencies, the
+order of SW with respect to the other memory accesses, and the branch (or EOP) last.
+Blocks are list-scheduled in program order, highest critical path first among the
+instructions that can issue earliest. A block entered by fall-through starts from the
+register readiness left by the previous block, one entered by a taken branch starts with
+all the registers ready (the flush leaves its producers far enough ahead). A block keeps
+its original order unless the schedule has fewer predicted stalls.
+
+The predicted stalls weight the stalls of each block, for both kinds of entry, by the
+entry counts of the profile of the original program. The measured stalls also include
+the stall cycles of wrong-path instructions, which are squashed by a taken branch and do
+not delay the program; they are reported separately. Registers R0-R31 are initialized to 0 and the data
+memory to 0 before the memory image, if any, is loaded; both runs must end with the same
+registers and the same sequence of stores.
+*/
+
+/* =============================================================
+
+   HAZARD MODEL
+
+   ============================================================= */
+
+/* cycles between the issue (RAW check passed in ID) of a producer and of a dependent instruction */
+template <class Config>
+unsigned producer_latency(opcode_t producer){
+	typedef sim_pipe_core<null_observer, Config> core;
+	unsigned ready;
+	if (!Config::forwarding) ready = core::L_MEM_WB + 1;
+	else ready = is_load(producer) ? core::L_MEM_WB : core::L_EXE_MEM;
+	return ready - core::L_ID_EXE;
+}
+
+// readiness of the registers at a point of the schedule
+struct issue_state_t{
+	unsigned last;             // issue cycle of the previous instruction
+	unsigned ready[NUM_GP_REGISTERS+NUM_VREGS]; // first cycle the register (general purpose or vector) can be read
+};
+
+/* issue cycle of "instr" after the instructions recorded in "state" */
+unsigned earliest_issue(const issue_state_t &state, const instruction_t &instr){
+	unsigned t = state.last + 1;
+	if (reads_src1(instr.opcode) && state.ready[instr.src1] > t) t = state.ready[instr.src1];
+	if (reads_src2(instr.opcode) && state.ready[instr.src2] > t) t = state.ready[instr.src2];
+	return t;
+}
+
+/* records the issue of "instr" at cycle "t" */
+template <class Config>
+void issue(issue_state_t &state, const instruction_t &instr, unsigned t){
+	state.last = t;
+	if (writes_register(instr.opcode)) state.ready[instr.dest] = t + producer_latency<Config>(instr.opcode);
+}
+
+/* stall cycles of the instruction sequence "order", starting from "state" (updated) */
+template <class Config>
+unsigned predicted_stalls(issue_state_t &state, sim_pipe_base *program, const vector<unsigned> &order){
+	unsigned stalls = 0;
+	for (unsigned k=0; k<order.size(); k++){
+		const instruction_t &instr = program->get_instruction(order[k]);
+		unsigned t = earliest_issue(state, instr);
+		stalls += t - state.last - 1;
+		issue<Config>(state, instr, t);
+	}
+	return stalls;
+}
+
+/* =============================================================
+
+   SCHEDULER
+
+   ============================================================= */
+
+/* returns true if instruction "j" has to stay after instruction "i" (i before j in the block) */
+bool depends(const instruction_t &i, const instruction_t &j){
+	bool i_writes = writes_register(i.opcode), j_writes = writes_register(j.opcode);
+	// RAW
+	if (i_writes && ((reads_src1(j.opcode) && j.src1 == i.dest) || (reads_src2(j.opcode) && j.src2 == i.dest))) return true;
+	// WAR
+	if (j_writes && ((reads_src1(i.opcode) && i.src1 == j.dest) || (reads_src2(i.opcode) && i.src2 == j.dest))) return true;
+	// WAW
+	if (i_writes && j_writes && i.dest == j.dest) return true;
+	// memory: no address disambiguation, stores are not reordered with other memory accesses
+	bool i_memory = is_memory(i.opcode) || is_vector_memory(i.opcode), j_memory = is_memory(j.opcode) || is_vector_memory(j.opcode);
+	bool i_store = i.opcode == SW || i.opcode == VSW || i.opcode == VSWS, j_store = j.opcode == SW || j.opcode == VSW || j.opcode == VSWS;
+	if (i_memory && j_memory && (i_store || j_store)) return true;
+	// the block terminator stays last
+	if (is_branch(j.opcode) || j.opcode == EOP) return true;
+	return false;
+}
+
+/* list-schedules the block [first, last] starting from "state"; returns the new order */
+template <class Config>
+vector<unsigned> schedule_block(const issue_state_t &state, sim_pipe_base *program, unsigned first, unsigned last){
+
+	unsigned n = last - first + 1;
+	vector<vector<unsigned> > succ(n);
+	vector<unsigned> npred(n, 0), height(n, 0);
+
+	// dependency DAG
+	for (unsigned i=0; i<n; i++)
+		for (unsigned j=i+1; j<n; j++)
+			if (depends(program->get_instruction(first+i), program->get_instruction(first+j))){
+				succ[i].push_back(j);
+				npred[j]++;
+			}
+
+	// critical path to the end of the block, in issue cycles
+	for (int i=n-1; i>=0; i--){
+		const instruction_t &instr = program->get_instruction(first+i);
+		unsigned latency = writes_register(instr.opcode) ? producer_latency<Config>(instr.opcode) : 1;
+		for (unsigned k=0; k<succ[i].size(); k++)
+			if (height[succ[i][k]] + latency > height[i]) height[i] = height[succ[i][k]] + latency;
+	}
+
+	issue_state_t s = state;
+	vector<unsigned> order;
+	vector<bool> done(n, false);
+	while (order.size() < n){
+		int best = -1;
+		unsigned best_t = 0;
+		for (unsigned i=0; i<n; i++){
+			if (done[i] || npred[i]) continue;
+			unsigned t = earliest_issue(s, program->get_instruction(first+i));
+			if (best == -1 || t < best_t || (t == best_t && height[i] > height[best])){
+				best = i;
+				best_t = t;
+			}
+		}
+		done[best] = true;
+		order.push_back(first+best);
+		issue<Config>(s, program->get_instruction(first+best), best_t);
+		for (unsigned k=0; k<succ[best].size(); k++) npred[succ[best][k]]--;
+	}
+	return order;
+}
+
+/* =============================================================
+
+   MEASUREMENT
+
+   ============================================================= */
+
+// observer hashing the sequence of stores, to check that the scheduled program computes the same,
+// and counting the stall cycles of wrong-path instructions (squashed by a taken branch), which the model ignores
+struct schedule_observer : public null_observer {
+	unsigned hash;
+	unsigned window;                   // cycles between the issue of a branch and its flush
+	unsigned recent[MAX_STAGES];       // cycles of the latest stalls
+	unsigned nrecent;
+	unsigned wrong_path;
+
+	schedule_observer() : hash(0), window(0), nrecent(0), wrong_path(0) {}
+	void on_memory(const memory_event_t &e){
+		if (e.is_store) hash = (hash*31 + e.address)*31 + e.value;
+	}
+	void on_stall(const stall_event_t &e){
+		if (e.cause != STALL_MEMORY) recent[nrecent++ % MAX_STAGES] = e.cycle;
+	}
+	void on_flush(const flush_event_t &e){
+		// the stalls after the issue of the branch belong to squashed instructions
+		for (unsigned k=0; k<nrecent && k<MAX_STAGES; k++)
+			if (recent[k] + window > e.cycle) wrong_path++;
+		nrecent = 0;
+	}
+};
+
+struct run_result_t{
+	unsigned cycles, stalls, executed;
+	unsigned stall_cycles[NUM_STALL_CAUSES];
+	unsigned wrong_path;
+	unsigned registers, stores;
+	vector<unsigned> retired; // per static instruction
+	vector<unsigned> taken;   // per static instruction, taken branches
+};
+
+/* runs "filename" on configuration "Config" */
+template <class Config>
+run_result_t measure(const char *filename, const char *image, unsigned mem_size){
+
+	typedef sim_pipe_core<schedule_observer, Config> core;
+	core *mips = new core(mem_size, 0);
+	mips->get_observer().window = core::L_EXE_MEM - core::L_ID_EXE;
+	mips->load_program(filename, 0x10000000);
+	for (unsigned i=0; i<NUM_GP_REGISTERS; i++) mips->set_gp_register(i, 0);
+	for (unsigned a=0; a+4<=mem_size; a+=4) mips->write_memory(a, 0);
+	if (image) mips->load_memory(image);
+	mips->run();
+
+	run_result_t result;
+	result.cycles = mips->get_clock_cycles();
+	result.stalls = mips->get_stalls();
+	result.executed = mips->get_instructions_executed();
+	for (int c=0; c<NUM_STALL_CAUSES; c++) result.stall_cycles[c] = 0;
+	for (unsigned i=0; i<mips->get_program_size(); i++){
+		result.retired.push_back(mips->get_profile().get_retired(i));
+		result.taken.push_back(mips->get_profile().get_flushes(i) / core::FLUSH_SLOTS);
+		for (int c=0; c<NUM_STALL_CAUSES; c++) result.stall_cycles[c] += mips->get_profile().get_stalls(i, (stall_cause_t)c);
+	}
+	result.registers = 0;
+	for (unsigned i=0; i<NUM_GP_REGISTERS; i++) result.registers = result.registers*31 + mips->get_gp_register(i);
+	result.stores = mips->get_observer().hash;
+	result.wrong_path = mips->get_observer().wrong_path;
+
+	delete mips;
+	return result;
+}
+
+void print_result(const char *name, const run_result_t &r){
+	cout << setw(12) << left << name << right << setw(12) << r.cycles << setw(12) << r.executed << setw(10) << r.stalls;
+	cout << setw(10) << r.stall_cycles[STALL_RAW] << setw(10) << r.stall_cycles[STALL_LOAD_USE] << setw(12) << r.wrong_path;
+	cout << "  " << hex << setw(8) << setfill('0') << r.registers << " " << setw(8) << r.stores << setfill(' ') << dec << endl;
+}
+
+/* schedules "input" into "output" for configuration "Config" and reports the savings */
+template <class Config>
+int schedule(const char *input, const char *output, const char *image, unsigned mem_size){
+
+	run_result_t before = measure<Config>(input, image, mem_size);
+
+	sim_pipe_base *program = new sim_pipe(0, 0);
+	program->load_program(input, 0x10000000);
+	unsigned size = program->get_program_size();
+	string *text = new string[size];
+	bool *leader = new bool[size];
+	program->annotate_program(text, leader);
+
+	vector<unsigned> order;
+	issue_state_t state;
+	state.last = 0;
+	for (unsigned r=0; r<NUM_GP_REGISTERS+NUM_VREGS; r++) state.ready[r] = 0;
+
+	unsigned blocks = 0, reordered = 0;
+	unsigned long long predicted_before = 0, predicted_after = 0;
+	for (unsigned first=0; first<size; ){
+		unsigned last = first;
+		while (last+1 < size && !leader[last+1] && program->get_instruction(last).opcode != EOP) last++;
+
+		// entries of the block by fall-through (the state left by the previous block applies)
+		// and by a taken branch (the flush leaves the producers far enough ahead: no RAW stall)
+		unsigned count = before.retired[first];
+		unsigned fall = 0;
+		if (first){
+			const instruction_t &prev = program->get_instruction(first-1);
+			if (is_branch(prev.opcode)) fall = before.retired[first-1] - before.taken[first-1];
+			else if (prev.opcode != EOP) fall = before.retired[first-1];
+		}
+		if (fall > count) fall = count;
+		unsigned jumped = count - fall;
+
+		issue_state_t drained = state;
+		for (unsigned r=0; r<NUM_GP_REGISTERS+NUM_VREGS; r++) drained.ready[r] = 0;
+		const issue_state_t &entry = (fall >= jumped) ? state : drained;
+
+		vector<unsigned> original;
+		for (unsigned i=first; i<=last; i++) original.push_back(i);
+		vector<unsigned> scheduled = schedule_block<Config>(entry, program, first, last);
+
+		issue_state_t s1 = state, s2 = drained;
+		unsigned long long cost_before = (unsigned long long)fall * predicted_stalls<Config>(s1, program, original) + (unsigned long long)jumped * predicted_stalls<Config>(s2, program, original);
+		issue_state_t s3 = state, s4 = drained;
+		unsigned long long cost_after = (unsigned long long)fall * predicted_stalls<Config>(s3, program, scheduled) + (unsigned long long)jumped * predicted_stalls<Config>(s4, program, scheduled);
+		if (cost_after < cost_before){
+			reordered++;
+			state = (fall >= jumped) ? s3 : s4;
+		} else {
+			scheduled = original;
+			cost_after = cost_before;
+			state = (fall >= jumped) ? s1 : s2;
+		}
+
+		predicted_before += cost_before;
+		predicted_after += cost_after;
+		order.insert(order.end(), scheduled.begin(), scheduled.end());
+		blocks++;
+		first = last+1;
+	}
+
+	// the labels stay at the beginning of their block, the branches refer to them by name
+	ofstream fout(output, ios::out);
+	if (!fout.is_open()) {
+		cerr << "error: open file " << output << " failed!" << endl;
+		exit(-1);
+	}
+	map<unsigned, string> &labels = program->get_labels();
+	for (unsigned k=0; k<order.size(); k++){
+		if (labels.count(k)) fout << labels[k] << ":\t";
+		fout << instr_to_string(program->get_instruction(order[k])) << endl;
+	}
+	fout.close();
+
+	run_result_t after = measure<Config>(output, image, mem_size);
+
+	cout << "Program: " << input << " -> " << output << endl;
+	cout << "Basic blocks: " << blocks << ", reordered: " << reordered << endl << endl;
+	cout << setw(12) << left << "" << right << setw(12) << "cycles" << setw(12) << "executed" << setw(10) << "stalls";
+	cout << setw(10) << "RAW" << setw(10) << "LOAD-USE" << setw(12) << "wrong-path" << "  regs     stores" << endl;
+	print_result("original", before);
+	print_result("scheduled", after);
+	cout << endl;
+	cout << "Predicted stalls: " << predicted_before << " -> " << predicted_after << endl;
+	cout << "Predicted stall savings: " << predicted_before - predicted_after << endl;
+	cout << "Measured stall savings:  " << (int)(before.stalls - after.stalls) << " (" << (int)((before.stalls - before.wrong_path) - (after.stalls - after.wrong_path)) << " without the wrong-path stalls)" << endl;
+	cout << "Measured cycle savings:  " << (int)(before.cycles - after.cycles) << endl;
+
+	bool same = before.registers == after.registers && before.stores == after.stores && before.executed == after.executed;
+	if (!same) cerr << "error: the scheduled program does not compute the same result!" << endl;
+
+	delete [] text;
+	delete [] leader;
+	delete program;
+	return same ? 0 : 1;
+}
+
+int main(int argc, char **argv){
+
+	const char *input = NULL, *output = NULL, *image = NULL;
+	string config = "classic";
+	unsigned mem_size = 4*1024*1024;
+
+	for (int i=1; i<argc; i++){
+		if (!strcmp(argv[i], "--mem") && i+1 < argc) image = argv[++i];
+		else if (!strcmp(argv[i], "--mem-size") && i+1 < argc) mem_size = strtoul(argv[++i], NULL, 0);
+		else if (!strcmp(argv[i], "--config") && i+1 < argc) config = argv[++i];
+		else if (input == NULL) input = argv[i];
+		else if (output == NULL) output = argv[i];
+		else {
+			cerr << "error: unexpected argument " << argv[i] << endl;
+			return 1;
+		}
+	}
+	if (input == NULL || output == NULL) {
+		cerr << "usage: " << argv[0] << " program.asm scheduled.asm [--mem memory.mem] [--mem-size BYTES] [--config NAME]" << endl;
+		return 1;
+	}
+
+	if (config == "classic") return schedule<classic_pipeline>(input, output, image, mem_size);
+	if (config == "pipeline_7") return schedule<pipeline_7>(input, output, image, mem_size);
+	if (config == "pipeline_8") return schedule<pipeline_8>(input, output, image, mem_size);
+	if (config == "classic+fwd") return schedule<with_forwarding<classic_pipeline> >(input, output, image, mem_size);
+	if (config == "pipeline_7+fwd") return schedule<with_forwarding<pipeline_7> >(input, output, image, mem_size);
+	if (config == "pipeline_8+fwd") return schedule<with_forwarding<pipeline_8> >(input, output, image, mem_size);
+
+	cerr << "error: unknown configuration " << config << endl;
+	return 1;
+}
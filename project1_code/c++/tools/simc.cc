@@ -0,0 +1,120 @@
+#include <iostream>
+#include <string>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+using namespace std;
+
+/*
+Client of the simulation daemon (see simd.cc).
+
+	bin/simc [--socket PATH] [--retry N] program.asm [memory.mem] [--cycles N]
+	bin/simc [--socket PATH] --stats
+	bin/simc [--socket PATH] --shutdown
+
+Sends the request and prints the reply of the daemon. When the daemon is saturated
+(BUSY), the request is sent again up to N times (default: 0), waiting 10ms, 20ms,
+40ms, ... in between. Exit status: 0 on success, 1 on error, 2 if the daemon is busy.
+*/
+
+/* sends "request" and prints the reply; returns the exit status, "busy" is set if the daemon rejected the request */
+static int send_request(const string &socket_path, const string &request, bool &busy){
+
+	busy = false;
+	int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	struct sockaddr_un addr;
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	strncpy(addr.sun_path, socket_path.c_str(), sizeof(addr.sun_path)-1);
+	if (fd < 0 || connect(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0) {
+		cerr << "error: cannot connect to " << socket_path << endl;
+		if (fd >= 0) close(fd);
+		return 1;
+	}
+
+	string line = request + "\n";
+	if (send(fd, line.data(), line.length(), MSG_NOSIGNAL) != (ssize_t)line.length()) {
+		cerr << "error: cannot send the request" << endl;
+		close(fd);
+		return 1;
+	}
+
+	// prints the reply line by line until END (or until the daemon closes the connection)
+	int status = 1;
+	bool failed = false;
+	string reply;
+	char buffer[4096];
+	ssize_t n;
+	while ((n = recv(fd, buffer, sizeof(buffer), 0)) > 0){
+		reply.append(buffer, n);
+		size_t end;
+		while ((end = reply.find('\n')) != string::npos){
+			string text = reply.substr(0, end);
+			reply.erase(0, end+1);
+			if (text == "BUSY") busy = true;
+			else if (text == "END") status = 0;
+			else if (text.compare(0, 6, "ERROR ") == 0) {
+				cerr << "error: " << text.substr(6) << endl;
+				failed = true;
+			}
+			else cout << text << endl;
+		}
+	}
+	close(fd);
+
+	// an ERROR reply also ends with END
+	return (status == 0 && !failed) ? 0 : 1;
+}
+
+/* returns the absolute path of "path" (the daemon does not share the working directory) */
+static string absolute(const char *path){
+	char resolved[PATH_MAX];
+	if (realpath(path, resolved) == NULL) return path;
+	return resolved;
+}
+
+int main(int argc, char **argv){
+
+	string socket_path = "/tmp/simd.sock";
+	string request;
+	const char *program = NULL, *image = NULL;
+	unsigned cycles = 0, retries = 0;
+
+	for (int i=1; i<argc; i++){
+		if (!strcmp(argv[i], "--socket") && i+1 < argc) socket_path = argv[++i];
+		else if (!strcmp(argv[i], "--retry") && i+1 < argc) retries = atoi(argv[++i]);
+		else if (!strcmp(argv[i], "--cycles") && i+1 < argc) cycles = strtoul(argv[++i], NULL, 0);
+		else if (!strcmp(argv[i], "--stats")) request = "STATS";
+		else if (!strcmp(argv[i], "--shutdown")) request = "SHUTDOWN";
+		else if (program == NULL) program = argv[i];
+		else if (image == NULL) image = argv[i];
+		else {
+			cerr << "error: unexpected argument " << argv[i] << endl;
+			return 1;
+		}
+	}
+	if (request.empty()){
+		if (program == NULL) {
+			cerr << "usage: " << argv[0] << " [--socket PATH] [--retry N] program.asm [memory.mem] [--cycles N] | --stats | --shutdown" << endl;
+			return 1;
+		}
+		request = "RUN " + absolute(program) + " " + (image ? absolute(image) : string("-")) + " " + to_string(cycles);
+	}
+
+	unsigned wait_ms = 10;
+	for (unsigned attempt=0; ; attempt++){
+		bool busy;
+		int status = send_request(socket_path, request, busy);
+		if (!busy) return status;
+		if (attempt == retries) {
+			cerr << "error: daemon busy" << endl;
+			return 2;
+		}
+		usleep(wait_ms * 1000);
+		wait_ms *= 2;
+	}
+}
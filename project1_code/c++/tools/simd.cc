@@ -0,0 +1,474 @@
+#include "sim_pipe.h"
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <vector>
+#include <chrono>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+
+using namespace std;
+
+/*
+Simulation daemon: runs jobs sent over a Unix domain socket (see simc.cc for the client).
+
+	bin/simd [--socket PATH] [--workers N] [--queue N] [--mem-size BYTES] [--latency CYCLES] [--chunk CYCLES] [--timeout MS]
+	         [--max-cycles CYCLES]
+
+	--socket PATH      socket to listen on (default: /tmp/simd.sock)
+	--workers N        simulators run in parallel, one per worker thread (default: 2)
+	--queue N          jobs waiting for a worker; further jobs are rejected with BUSY (default: 16)
+	--mem-size BYTES   data memory of the simulators (default: 4MB)
+	--latency CYCLES   data memory latency of the simulators (default: 0)
+	--chunk CYCLES     cycles between two PROGRESS lines of a job (default: 1000000)
+	--timeout MS       time a client has to send its request line (default: 2000)
+	--max-cycles N     cycles a job may run at most, 0 for no limit (default: 100000000)
+
+Each simulator is created once and reused: a job only resets it, loads the program and
+the memory image and runs. Parsed programs and memory images are cached by path and
+parsed again only when the file changes (modification time or size).
+
+Protocol - one request line per connection, the reply ends with a line "END":
+
+	RUN <program> [<memory image>|-] [<max cycles>]
+		PROGRESS <cycles> <instructions>      every --chunk cycles
+		<statistic> <value>                   when the job completes (or reaches max cycles)
+		                                      max cycles is 0 or absent for --max-cycles, and at most --max-cycles
+	STATS
+		<counter> <value>                     daemon counters
+	SHUTDOWN
+
+A RUN request gets the single line "BUSY" (no END) when the job queue is full, and
+"ERROR <message>" followed by END when the job cannot be run, or when it accesses a data
+address outside data memory ("ERROR address out of range ..."). Paths are opened by the
+daemon, so they should be absolute. Registers are initialized to 0 before a job runs.
+A job whose client has closed the connection is aborted at its next PROGRESS line.
+
+The request lines are read by the thread that accepts the connections, which polls them
+all: a connection whose request line is not complete within --timeout gets "ERROR timeout"
+followed by END, and a slow client does not delay the others.
+*/
+
+/* =============================================================
+
+   CACHES
+
+   ============================================================= */
+
+// cache entry: the parsed content of a file and the version of the file it was parsed from
+template <class T>
+struct cache_entry_t{
+	shared_ptr<const T> value;
+	time_t mtime;
+	off_t size;
+};
+
+template <class T>
+class file_cache{
+
+	map<string, cache_entry_t<T> > entries;
+	mutex lock;
+	unsigned hits, misses;
+
+public:
+
+	file_cache() : hits(0), misses(0) {}
+
+	/* returns the content of "path", parsed with "parse" if the file is not cached or has changed;
+	   NULL, with the reason in "error", if it cannot be read or parsed (a failed parse is not cached) */
+	template <class Parse>
+	shared_ptr<const T> get(const string &path, Parse parse, string &error){
+		struct stat st;
+		if (stat(path.c_str(), &st) != 0 || !S_ISREG(st.st_mode) || access(path.c_str(), R_OK) != 0) {
+			error = "cannot read " + path;
+			return NULL;
+		}
+
+		lock_guard<mutex> guard(lock);
+		typename map<string, cache_entry_t<T> >::iterator it = entries.find(path);
+		if (it != entries.end() && it->second.mtime == st.st_mtime && it->second.size == st.st_size){
+			hits++;
+			return it->second.value;
+		}
+		misses++;
+		shared_ptr<T> value(new T);
+		if (!parse(path.c_str(), *value, error)) return NULL;
+		cache_entry_t<T> entry;
+		entry.value = value;
+		entry.mtime = st.st_mtime;
+		entry.size = st.st_size;
+		entries[path] = entry;
+		return value;
+	}
+
+	/* writes the counters of the cache, named after "name" */
+	void stats(stringstream &ss, const string &name){
+		lock_guard<mutex> guard(lock);
+		ss << name << "s_cached " << entries.size() << "\n";
+		ss << name << "_hits " << hits << "\n";
+		ss << name << "_misses " << misses << "\n";
+	}
+};
+
+/* =============================================================
+
+   DAEMON
+
+   ============================================================= */
+
+struct options_t{
+	string socket_path;
+	unsigned workers, queue, mem_size, latency, chunk, timeout, max_cycles;
+};
+
+struct job_t{
+	int fd;
+	string program, image;
+	unsigned max_cycles;
+};
+
+// connection whose request line has not been received completely
+struct connection_t{
+	int fd;
+	string line;
+	chrono::steady_clock::time_point deadline;
+};
+
+/* sends "text" on the connection; returns false if it failed (e.g. client gone) */
+static bool reply(int fd, const string &text){
+	size_t sent = 0;
+	while (sent < text.length()){
+		ssize_t n = send(fd, text.data() + sent, text.length() - sent, MSG_NOSIGNAL);
+		if (n <= 0) return false;
+		sent += n;
+	}
+	return true;
+}
+
+/* reads the data available on the connection without blocking; returns 1 when the request line is
+   complete, -1 if the connection is closed or the line is too long, 0 if more data is expected */
+static int read_available(connection_t &c){
+	char buffer[512];
+	ssize_t n = recv(c.fd, buffer, sizeof(buffer), MSG_DONTWAIT);
+	if (n == 0) return -1;
+	if (n < 0) return (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) ? 0 : -1;
+	for (ssize_t i=0; i<n; i++){
+		if (buffer[i] == '\n') return 1;
+		if (buffer[i] != '\r') c.line += buffer[i];
+	}
+	return (c.line.length() < 4096) ? 0 : -1;
+}
+
+class sim_daemon{
+
+	options_t &opt;
+
+	file_cache<program_t> programs;
+	file_cache<memory_image_t> images;
+
+	// bounded job queue
+	deque<job_t> queue;
+	mutex queue_lock;
+	condition_variable queue_ready;
+	bool stopping;
+
+	vector<thread> workers;
+
+	// counters
+	mutex stats_lock;
+	unsigned jobs_done, jobs_failed, jobs_rejected, jobs_aborted, busy_workers, requests_timed_out;
+	unsigned long long cycles_simulated;
+
+public:
+
+	sim_daemon(options_t &o) : opt(o), stopping(false), jobs_done(0), jobs_failed(0), jobs_rejected(0), jobs_aborted(0), busy_workers(0), requests_timed_out(0), cycles_simulated(0) {}
+
+	/* worker thread: runs the jobs of the queue on its own simulator */
+	void work(){
+		sim_pipe *mips = new sim_pipe(opt.mem_size, opt.latency);
+		while (true){
+			job_t job;
+			{
+				unique_lock<mutex> guard(queue_lock);
+				queue_ready.wait(guard, [this]{ return stopping || !queue.empty(); });
+				if (queue.empty()) break;
+				job = queue.front();
+				queue.pop_front();
+			}
+			{
+				lock_guard<mutex> guard(stats_lock);
+				busy_workers++;
+			}
+			bool ok = run_job(mips, job);
+			close(job.fd);
+			{
+				lock_guard<mutex> guard(stats_lock);
+				busy_workers--;
+				if (ok) jobs_done++;
+				else jobs_failed++;
+			}
+		}
+		delete mips;
+	}
+
+	bool run_job(sim_pipe *mips, job_t &job){
+
+		// read_program uses strtok: the programs are parsed one at a time, under the program cache lock
+		string error;
+		shared_ptr<const program_t> program = programs.get(job.program, read_program, error);
+		if (!program) {
+			reply(job.fd, "ERROR " + error + "\nEND\n");
+			return false;
+		}
+		shared_ptr<const memory_image_t> image;
+		if (!job.image.empty()) {
+			image = images.get(job.image, read_memory_image, error);
+			if (!image) {
+				reply(job.fd, "ERROR " + error + "\nEND\n");
+				return false;
+			}
+			for (unsigned i=0; i<image->size(); i++)
+				if ((*image)[i].first > opt.mem_size - 4) {
+					reply(job.fd, "ERROR " + job.image + " does not fit in data memory\nEND\n");
+					return false;
+				}
+		}
+
+		mips->reset();
+		mips->load_program(*program, 0x10000000);
+		for (unsigned i=0; i<NUM_GP_REGISTERS; i++) mips->set_gp_register(i, 0);
+		if (image) mips->load_memory(*image);
+
+		// the job cannot hold its worker longer than --max-cycles
+		unsigned max_cycles = job.max_cycles;
+		if (opt.max_cycles && (max_cycles == 0 || max_cycles > opt.max_cycles)) max_cycles = opt.max_cycles;
+
+		// runs in chunks, so that long jobs report their progress (and stop when the client is gone)
+		bool completed = false;
+		while (!completed){
+			unsigned chunk = opt.chunk;
+			if (max_cycles && max_cycles - mips->get_clock_cycles() < chunk) chunk = max_cycles - mips->get_clock_cycles();
+			if (chunk == 0) break;
+			unsigned before = mips->get_clock_cycles();
+			mips->run(chunk);
+			completed = mips->get_clock_cycles() - before < chunk;
+			if (!completed && mips->get_clock_cycles() != max_cycles &&
+			    !reply(job.fd, "PROGRESS " + to_string(mips->get_clock_cycles()) + " " + to_string(mips->get_instructions_executed()) + "\n")) {
+				lock_guard<mutex> guard(stats_lock);
+				jobs_aborted++;
+				return false;
+			}
+		}
+
+		if (mips->get_memory_fault() != UNDEFINED) {
+			stringstream ss;
+			ss << "ERROR address out of range 0x" << hex << mips->get_memory_fault() << " (instruction at 0x" << mips->get_memory_fault_pc() << ")\nEND\n";
+			reply(job.fd, ss.str());
+			return false;
+		}
+
+		unsigned checksum = 0;
+		for (unsigned i=0; i<NUM_GP_REGISTERS; i++) checksum = checksum*31 + mips->get_gp_register(i);
+
+		stringstream ss;
+		ss << "status " << (completed ? "done" : "max_cycles") << "\n";
+		ss << "cycles " << mips->get_clock_cycles() << "\n";
+		ss << "instructions " << mips->get_instructions_executed() << "\n";
+		ss << "stalls " << mips->get_stalls() << "\n";
+		ss << "ipc " << mips->get_IPC() << "\n";
+		ss << "registers " << hex << checksum << dec << "\n";
+		ss << "END\n";
+		reply(job.fd, ss.str());
+
+		lock_guard<mutex> guard(stats_lock);
+		cycles_simulated += mips->get_clock_cycles();
+		return true;
+	}
+
+	/* queues a job; returns false if the queue is full */
+	bool submit(job_t &job){
+		lock_guard<mutex> guard(queue_lock);
+		if (queue.size() >= opt.queue) return false;
+		queue.push_back(job);
+		queue_ready.notify_one();
+		return true;
+	}
+
+	string stats(){
+		stringstream ss;
+		{
+			lock_guard<mutex> guard(stats_lock);
+			ss << "jobs_done " << jobs_done << "\n";
+			ss << "jobs_failed " << jobs_failed << "\n";
+			ss << "jobs_rejected " << jobs_rejected << "\n";
+			ss << "jobs_aborted " << jobs_aborted << "\n";
+			ss << "busy_workers " << busy_workers << "\n";
+			ss << "requests_timed_out " << requests_timed_out << "\n";
+			ss << "cycles_simulated " << cycles_simulated << "\n";
+		}
+		{
+			lock_guard<mutex> guard(queue_lock);
+			ss << "queued " << queue.size() << "\n";
+		}
+		programs.stats(ss, "program");
+		images.stats(ss, "image");
+		ss << "END\n";
+		return ss.str();
+	}
+
+	/* handles the request "line" of a connection; returns false on SHUTDOWN */
+	bool serve(int fd, const string &line){
+		stringstream ss(line);
+		string command;
+		ss >> command;
+
+		if (command == "RUN"){
+			job_t job;
+			job.fd = fd;
+			job.max_cycles = 0;
+			ss >> job.program >> job.image >> job.max_cycles;
+			if (job.image == "-") job.image.clear();
+			if (job.program.empty()) {
+				reply(fd, "ERROR missing program\nEND\n");
+				close(fd);
+			} else if (!submit(job)) {
+				reply(fd, "BUSY\n");
+				close(fd);
+				lock_guard<mutex> guard(stats_lock);
+				jobs_rejected++;
+			}
+			return true;
+		}
+		if (command == "STATS") reply(fd, stats());
+		else if (command == "SHUTDOWN") reply(fd, "END\n");
+		else reply(fd, "ERROR unknown request\nEND\n");
+		close(fd);
+		return command != "SHUTDOWN";
+	}
+
+	int main_loop(){
+		int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+		struct sockaddr_un addr;
+		memset(&addr, 0, sizeof(addr));
+		addr.sun_family = AF_UNIX;
+		if (listener < 0 || opt.socket_path.length() >= sizeof(addr.sun_path)) {
+			cerr << "error: cannot create socket " << opt.socket_path << endl;
+			return 1;
+		}
+		strcpy(addr.sun_path, opt.socket_path.c_str());
+		unlink(opt.socket_path.c_str());
+		if (bind(listener, (struct sockaddr *)&addr, sizeof(addr)) != 0 || listen(listener, 64) != 0) {
+			cerr << "error: cannot listen on " << opt.socket_path << endl;
+			return 1;
+		}
+
+		for (unsigned w=0; w<opt.workers; w++) workers.push_back(thread(&sim_daemon::work, this));
+		cerr << "simd: listening on " << opt.socket_path << " (" << opt.workers << " workers, queue of " << opt.queue << ")" << endl;
+
+		// polls the listener and the connections whose request line is incomplete
+		vector<connection_t> pending;
+		bool running = true;
+		while (running){
+			vector<struct pollfd> fds(1, pollfd{listener, POLLIN, 0});
+			int wait = -1;
+			chrono::steady_clock::time_point now = chrono::steady_clock::now();
+			for (unsigned i=0; i<pending.size(); i++){
+				fds.push_back(pollfd{pending[i].fd, POLLIN, 0});
+				long long left = chrono::duration_cast<chrono::milliseconds>(pending[i].deadline - now).count() + 1;
+				if (left < 0) left = 0;
+				if (wait < 0 || left < wait) wait = (int)left;
+			}
+			if (poll(fds.data(), fds.size(), wait) < 0 && errno != EINTR) continue;
+
+			now = chrono::steady_clock::now();
+			for (unsigned i=pending.size(); i-- > 0; ){
+				int status = fds[i+1].revents ? read_available(pending[i]) : 0;
+				if (status == 0 && now < pending[i].deadline) continue;
+				connection_t c = pending[i];
+				pending.erase(pending.begin() + i);
+				if (status > 0) {
+					if (!serve(c.fd, c.line)) running = false;
+					continue;
+				}
+				if (status == 0) {
+					reply(c.fd, "ERROR timeout\nEND\n");
+					lock_guard<mutex> guard(stats_lock);
+					requests_timed_out++;
+				}
+				close(c.fd);
+			}
+
+			if (running && (fds[0].revents & POLLIN)) {
+				int fd = accept(listener, NULL, NULL);
+				if (fd >= 0) pending.push_back(connection_t{fd, "", now + chrono::milliseconds(opt.timeout)});
+			}
+		}
+		for (unsigned i=0; i<pending.size(); i++) close(pending[i].fd);
+
+		// completes the queued jobs
+		{
+			lock_guard<mutex> guard(queue_lock);
+			stopping = true;
+			queue_ready.notify_all();
+		}
+		for (unsigned w=0; w<workers.size(); w++) workers[w].join();
+		close(listener);
+		unlink(opt.socket_path.c_str());
+		return 0;
+	}
+};
+
+int main(int argc, char **argv){
+
+	options_t opt;
+	opt.socket_path = "/tmp/simd.sock";
+	opt.workers = 2;
+	opt.queue = 16;
+	opt.mem_size = 4*1024*1024;
+	opt.latency = 0;
+	opt.chunk = 1000000;
+	opt.timeout = 2000;
+	opt.max_cycles = 100000000;
+
+	for (int i=1; i<argc; i++){
+		if (i+1 == argc) {
+			cerr << "error: missing value for " << argv[i] << endl;
+			return 1;
+		}
+		const char *arg = argv[i++];
+		if (!strcmp(arg, "--socket")) opt.socket_path = argv[i];
+		else if (!strcmp(arg, "--workers")) opt.workers = atoi(argv[i]);
+		else if (!strcmp(arg, "--queue")) opt.queue = atoi(argv[i]);
+		else if (!strcmp(arg, "--mem-size")) opt.mem_size = strtoul(argv[i], NULL, 0);
+		else if (!strcmp(arg, "--latency")) opt.latency = atoi(argv[i]);
+		else if (!strcmp(arg, "--chunk")) opt.chunk = strtoul(argv[i], NULL, 0);
+		else if (!strcmp(arg, "--timeout")) opt.timeout = strtoul(argv[i], NULL, 0);
+		else if (!strcmp(arg, "--max-cycles")) opt.max_cycles = strtoul(argv[i], NULL, 0);
+		else {
+			cerr << "error: unknown option " << arg << endl;
+			return 1;
+		}
+	}
+	if (opt.workers == 0 || opt.chunk == 0 || opt.mem_size < 4) {
+		cerr << "error: invalid options" << endl;
+		return 1;
+	}
+
+	signal(SIGPIPE, SIG_IGN);
+
+	sim_daemon d(opt);
+	return d.main_loop();
+}
@@ -0,0 +1,100 @@
+#include "sim_pipe_core.h"
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+
+using namespace std;
+
+/*
+Records the trace of a program, then re-times it on every pipeline configuration of sim_pipe.h
+by replaying the trace, and compares with executing the program on the same configuration.
+
+	bin/trace program.asm [memory.mem] [--trace FILE] [--latency N] [--mem-size BYTES] [--io BASE]
+
+The trace is recorded on the classic pipeline in FILE (default: program.asm.trace), which is
+kept. Registers R0-R31 are initialized to 0 and the data memory (4MB by default) to 0xFF before
+the memory image, if any, is loaded. --latency sets the data memory latency (default: 0) and
+--io maps the devices at BASE.
+
+Build with optimizations to get meaningful times:
+	make OPT=-O2 trace
+*/
+
+static const char *program, *image;
+static unsigned latency = 0, mem_size = 4*1024*1024, io_base = UNDEFINED;
+
+/* runs the program (recording its trace in "record" if not NULL, or replaying the trace "replay" on a with_replay configuration); returns the wall-clock time in seconds */
+template <class Observer, class Config>
+double run(const char *record, const char *replay, unsigned &cycles, unsigned &instructions){
+
+	sim_pipe_core<Observer, Config> *mips = new sim_pipe_core<Observer, Config>(mem_size, latency);
+	mips->set_io_base(io_base);
+	mips->load_program(program, 0x10000000);
+	for (unsigned i=0; i<NUM_GP_REGISTERS; i++) mips->set_gp_register(i, 0);
+	if (image) mips->load_memory(image);
+	if constexpr (Config::replay) mips->replay_trace(replay);
+	if constexpr (is_same<Observer, trace_observer>::value) mips->get_observer().writer.open(record);
+
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+	mips->run();
+	double elapsed = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+	if constexpr (is_same<Observer, trace_observer>::value) mips->get_observer().writer.close();
+	cycles = mips->get_clock_cycles();
+	instructions = mips->get_instructions_executed();
+	delete mips;
+	return elapsed;
+}
+
+/* executes the program and replays the trace on configuration "Config"; prints one row of the comparison */
+template <class Config>
+void compare(const char *name, const char *trace){
+	unsigned executed, replayed, instructions;
+	double t_executed = run<null_observer, Config>(NULL, NULL, executed, instructions);
+	double t_replayed = run<null_observer, with_replay<Config> >(NULL, trace, replayed, instructions);
+	cout << setw(22) << left << name << right << setw(12) << executed << setw(12) << replayed;
+	cout << setw(14) << fixed << setprecision(3) << t_executed * 1000 << setw(14) << t_replayed * 1000;
+	cout << (executed == replayed ? "" : "  (the path depends on the timing)") << endl;
+}
+
+int main(int argc, char **argv){
+
+	string trace;
+
+	for (int i=1; i<argc; i++){
+		if (!strcmp(argv[i], "--trace") && i+1 < argc) trace = argv[++i];
+		else if (!strcmp(argv[i], "--latency") && i+1 < argc) latency = strtoul(argv[++i], NULL, 0);
+		else if (!strcmp(argv[i], "--mem-size") && i+1 < argc) mem_size = strtoul(argv[++i], NULL, 0);
+		else if (!strcmp(argv[i], "--io") && i+1 < argc) io_base = strtoul(argv[++i], NULL, 0);
+		else if (argv[i][0] != '-' && program == NULL) program = argv[i];
+		else if (argv[i][0] != '-' && image == NULL) image = argv[i];
+		else {
+			cerr << "usage: " << argv[0] << " program.asm [memory.mem] [--trace FILE] [--latency N] [--mem-size BYTES] [--io BASE]" << endl;
+			return 1;
+		}
+	}
+	if (program == NULL) {
+		cerr << "usage: " << argv[0] << " program.asm [memory.mem] [--trace FILE] [--latency N] [--mem-size BYTES] [--io BASE]" << endl;
+		return 1;
+	}
+	if (trace.empty()) trace = string(program) + ".trace";
+
+	unsigned cycles, instructions;
+	double t_record = run<trace_observer, classic_pipeline>(trace.c_str(), NULL, cycles, instructions);
+	cout << "Program: " << program << ", data memory latency " << latency << endl;
+	cout << "Trace: " << trace << ", " << instructions << " instructions recorded in " << fixed << setprecision(3) << t_record * 1000 << " ms" << endl;
+	cout << setw(22) << left << "configuration" << right << setw(12) << "cycles" << setw(12) << "replayed";
+	cout << setw(14) << "executed(ms)" << setw(14) << "replayed(ms)" << endl;
+
+	compare<classic_pipeline>("classic (5)", trace.c_str());
+	compare<pipeline_7>("pipeline_7", trace.c_str());
+	compare<pipeline_8>("pipeline_8", trace.c_str());
+	compare<with_forwarding<classic_pipeline> >("classic (5) + fwd", trace.c_str());
+	compare<with_forwarding<pipeline_7> >("pipeline_7 + fwd", trace.c_str());
+	compare<with_forwarding<pipeline_8> >("pipeline_8 + fwd", trace.c_str());
+
+	return 0;
+}